@@ -0,0 +1,185 @@
+/**
+ * @file admission.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Admission of elves to workshop by selectable policy
+ *
+ * With POLICY_NONE elves race for waitInQueue semaphore. Other policies keep
+ * admission queue in elf slots protected by elfQueueMutex and wake selected elf
+ * through its own semaphore.
+ */
+
+#include <string.h>
+
+#include "admission.h"
+
+static const char *policyNames[] = { "none", "fifo", "lifo", "lwf", "fair" };
+
+/**
+ * @brief Get admission policy from its name
+ *
+ * @param name name of policy (none, fifo, lifo, lwf, fair)
+ * @param policy output policy
+ * @return ReturnCode with NO_ERROR if it was successful or INVALID_ARGUMENT_ERROR
+ */
+ReturnCode parsePolicy(const char *name, AdmissionPolicy *policy)
+{
+  for (size_t i = 0; i < sizeof(policyNames) / sizeof(policyNames[0]); i++)
+  {
+    if (strcmp(name, policyNames[i]) == 0)
+    {
+      *policy = (AdmissionPolicy)i;
+      return NO_ERROR;
+    }
+  }
+
+  return INVALID_ARGUMENT_ERROR;
+}
+
+/**
+ * @brief Get name of admission policy
+ */
+const char *policyName(AdmissionPolicy policy)
+{
+  return policyNames[policy];
+}
+
+/**
+ * @brief Get slot of elf with @p id in current workshop
+ *
+ * @return slot or NULL when id is outside of capacity
+ */
+ElfSlot *elfSlot(size_t id)
+{
+  if (id == 0 || id > ctx->sharedMemory->elfCapacity) return NULL;
+  return &ctx->workshops[ctx->workshopIndex].elfSlots[id - 1];
+}
+
+/**
+ * @brief Check if waiting elf @p a should be admitted before @p b by current policy
+ */
+static bool admitsBefore(const ElfSlot *a, const ElfSlot *b, int64_t now)
+{
+  switch (ctx->params.policy)
+  {
+    case POLICY_LIFO:
+      return a->ticket > b->ticket;
+
+    case POLICY_LWF:
+    {
+      int64_t waitedA = a->waitedTotal + (now - a->queuedSince);
+      int64_t waitedB = b->waitedTotal + (now - b->queuedSince);
+      if (waitedA != waitedB) return waitedA > waitedB;
+      break;
+    }
+
+    case POLICY_FAIR:
+      if (a->helps != b->helps) return a->helps < b->helps;
+      break;
+
+    default:
+      break;
+  }
+
+  return a->ticket < b->ticket;
+}
+
+/**
+ * @brief Wait until elf with @p id is admitted to workshop
+ *
+ * Returns immediately when workshop is closed
+ *
+ * @param id id of elf
+ */
+void admitElf(size_t id)
+{
+  ElfSlot *slot = elfSlot(id);
+
+  if (ctx->params.policy == POLICY_NONE || slot == NULL)
+  {
+    SEM_WAIT(&ctx->semHolder->waitInQueue);
+    return;
+  }
+
+  SEM_WAIT(&ctx->semHolder->elfQueueMutex);
+
+  if (ctx->sharedMemory->shopClosed || (ctx->sharedMemory->freeSeats > 0 && ctx->sharedMemory->waitingElves == 0))
+  {
+    if (!ctx->sharedMemory->shopClosed)
+      ctx->sharedMemory->freeSeats--;
+
+    sem_post(&ctx->semHolder->elfQueueMutex);
+    return;
+  }
+
+  slot->waiting = true;
+  slot->ticket = ctx->sharedMemory->nextTicket++;
+  ctx->sharedMemory->waitingElves++;
+
+  sem_post(&ctx->semHolder->elfQueueMutex);
+
+  sem_wait(&slot->admitted);
+}
+
+/**
+ * @brief Free seats of helped group and admit next elves by policy
+ *
+ * Caller holds elfQueueMutex
+ */
+void releaseSeats()
+{
+  if (ctx->params.policy == POLICY_NONE)
+  {
+    for (int i = 0; i < WORKSHOP_SEATS; i++)
+      sem_post(&ctx->semHolder->waitInQueue);
+    return;
+  }
+
+  ctx->sharedMemory->freeSeats += WORKSHOP_SEATS;
+
+  int64_t now = monotonicTime();
+  ElfSlot *slots = ctx->workshops[ctx->workshopIndex].elfSlots;
+  size_t count = ctx->sharedMemory->numberOfElves;
+  if (count > ctx->sharedMemory->elfCapacity)
+    count = ctx->sharedMemory->elfCapacity;
+
+  while (ctx->sharedMemory->freeSeats > 0 && ctx->sharedMemory->waitingElves > 0)
+  {
+    ElfSlot *best = NULL;
+    for (size_t i = 0; i < count; i++)
+    {
+      if (slots[i].waiting && (best == NULL || admitsBefore(&slots[i], best, now)))
+        best = &slots[i];
+    }
+
+    if (best == NULL) break;
+
+    best->waiting = false;
+    ctx->sharedMemory->waitingElves--;
+    ctx->sharedMemory->freeSeats--;
+    sem_post(&best->admitted);
+  }
+}
+
+/**
+ * @brief Admit all waiting elves after workshop was closed
+ */
+void releaseAllElves()
+{
+  if (ctx->params.policy == POLICY_NONE) return;
+
+  SEM_WAIT(&ctx->semHolder->elfQueueMutex);
+
+  ElfSlot *slots = ctx->workshops[ctx->workshopIndex].elfSlots;
+  for (size_t i = 0; i < ctx->sharedMemory->elfCapacity; i++)
+  {
+    if (slots[i].waiting)
+    {
+      slots[i].waiting = false;
+      sem_post(&slots[i].admitted);
+    }
+  }
+  ctx->sharedMemory->waitingElves = 0;
+
+  sem_post(&ctx->semHolder->elfQueueMutex);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file admission.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for admission of elves to workshop
+ */
+
+#ifndef IOS_PROJECT2_ADMISSION_H
+#define IOS_PROJECT2_ADMISSION_H
+
+#include <semaphore.h>
+#include <stdbool.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "timing.h"
+#include "probes.h"
+
+#define WORKSHOP_SEATS 3          /**< Number of elves helped together */
+#define MAX_ELVES 16384           /**< Capacity of elf slots when elves can be added on signal */
+
+ReturnCode parsePolicy(const char *name, AdmissionPolicy *policy);
+const char *policyName(AdmissionPolicy policy);
+ElfSlot *elfSlot(size_t id);
+void admitElf(size_t id);
+void releaseSeats();
+void releaseAllElves();
+
+#endif //IOS_PROJECT2_ADMISSION_H
@@ -7,40 +7,48 @@
 
 #include "error_handling.h"
 
-bool notified = false;
-
 /**
  * @brief Deallocate all used memory, kill processes and exit
  */
 void terminate()
 {
-  if (getpid() == processHolder.mainId)
+  if (getpid() == ctx->processHolder.mainId)
   {
-    for (size_t j = 0; j < processHolder.elvesCount; j++)
+    for (size_t j = 0; j < ctx->processHolder.elvesCount; j++)
     {
-      if (processHolder.elfIds[j] != 0)
-        kill(processHolder.elfIds[j], SIGQUIT);
+      if (ctx->processHolder.elfIds[j] != 0)
+        kill(ctx->processHolder.elfIds[j], SIGQUIT);
     }
 
-    for (size_t j = 0; j < processHolder.rdCount; j++)
+    for (size_t j = 0; j < ctx->processHolder.rdCount; j++)
     {
-      if (processHolder.rdIds[j] != 0)
-        kill(processHolder.rdIds[j], SIGQUIT);
+      if (ctx->processHolder.rdIds[j] != 0)
+        kill(ctx->processHolder.rdIds[j], SIGQUIT);
     }
 
-    if (processHolder.santaId != 0)
+    if (ctx->processHolder.santaId != 0)
     {
-      kill(processHolder.santaId, SIGQUIT);
+      kill(ctx->processHolder.santaId, SIGQUIT);
+    }
+
+    for (size_t j = 0; j < ctx->processHolder.runnerCount; j++)
+    {
+      if (ctx->processHolder.runnerIds[j] != 0)
+        kill(ctx->processHolder.runnerIds[j], SIGQUIT);
     }
 
     deallocateResources();
   }
-  else if (!notified)
+  else if (!ctx->notified)
   {
-    notified = true;
-    kill(processHolder.mainId, SIGQUIT);
+    ctx->notified = true;
+    kill(ctx->processHolder.mainId, SIGQUIT);
   }
 
+  // Forked processes must not flush stdio buffers inherited from main process
+  if (getpid() != ctx->processHolder.mainId)
+    _exit(1);
+
   exit(1);
 }
 
@@ -84,5 +92,17 @@ void handleErrors(ReturnCode code)
   if ((code & UNEXPECTED_ERROR) >> 9)
     fprintf(stderr, "Unexpected error\n");
 
+  if ((code & MEMORY_ALLOCATION_ERROR) >> 10)
+    fprintf(stderr, "Failed to allocate memory\n");
+
+  if ((code & PIPE_CREATE_ERROR) >> 11)
+    fprintf(stderr, "Failed to create event pipe\n");
+
+  if ((code & NETWORK_ERROR) >> 12)
+    fprintf(stderr, "Network communication failed\n");
+
+  if ((code & SIMULATION_BUSY_ERROR) >> 13)
+    fprintf(stderr, "Simulation is already running\n");
+
   terminate();
 }
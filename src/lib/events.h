@@ -0,0 +1,45 @@
+/**
+ * @file events.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Event classes and compile-time event filtering
+ *
+ * Set of printed events is selected at compile time by EVENT_MASK (make EVENT_MASK=...),
+ * disabled events are removed from process handlers entirely including their output lock
+ * and action id.
+ */
+
+#ifndef IOS_PROJECT2_EVENTS_H
+#define IOS_PROJECT2_EVENTS_H
+
+#include "utils.h"
+
+#define EVENT_ELF_STARTED       0x0001  /**< Elf: started */
+#define EVENT_ELF_NEED_HELP     0x0002  /**< Elf: need help */
+#define EVENT_ELF_GET_HELP      0x0004  /**< Elf: get help */
+#define EVENT_ELF_HOLIDAYS      0x0008  /**< Elf: taking holidays */
+#define EVENT_RD_STARTED        0x0010  /**< RD: rstarted */
+#define EVENT_RD_RETURN         0x0020  /**< RD: return home */
+#define EVENT_RD_HITCHED        0x0040  /**< RD: get hitched */
+#define EVENT_SANTA_SLEEP       0x0080  /**< Santa: going to sleep */
+#define EVENT_SANTA_HELP        0x0100  /**< Santa: helping elves */
+#define EVENT_SANTA_CLOSING     0x0200  /**< Santa: closing workshop */
+#define EVENT_SANTA_CHRISTMAS   0x0400  /**< Santa: Christmas started */
+#define EVENT_SANTA_HITCHING    0x0800  /**< Santa: hitching reindeers (Christmas of season but the last) */
+
+#define EVENT_ALL               0x0fff  /**< All events */
+
+
+#ifndef EVENT_MASK
+#define EVENT_MASK EVENT_ALL
+#endif
+
+/**
+ * @brief Print event of class @p cls when it is enabled in EVENT_MASK
+ *
+ * Condition is constant so disabled events are compiled away
+ */
+#define EMIT(cls, entityName, id, message) \
+  do { if ((EVENT_MASK) & (cls)) printToOutput(entityName, id, message); } while (0)
+
+#endif //IOS_PROJECT2_EVENTS_H
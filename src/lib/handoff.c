@@ -0,0 +1,237 @@
+/**
+ * @file handoff.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Group service protocols between Santa and elves
+ *
+ * HANDOFF_CLASSIC releases every elf of group by its own post of waitForHelp and collects
+ * every elf by elfHelped. HANDOFF_GROUP releases whole group by one futex wake of help
+ * generation and collects it by one counter, last elf of group wakes Santa once.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "handoff.h"
+
+static const char *handoffNames[] = { "classic", "group" };
+
+/**
+ * @brief Count one futex syscall of group service, only when report is printed
+ */
+#define COUNT_SYSCALL() \
+  do { \
+    if (ctx->params.report) \
+      __atomic_add_fetch(&ctx->sharedMemory->handoffSyscalls, 1, __ATOMIC_RELAXED); \
+  } while (0)
+
+/**
+ * @brief Number of processes blocked on semaphore @p sem of SemHolder
+ */
+#define SEM_WAITERS(sem) (ctx->sharedMemory->semWaiters[(sem) - (sem_t *)ctx->semHolder])
+
+/**
+ * @brief Get handoff mode from its name (classic, group)
+ */
+ReturnCode parseHandoff(const char *name, HandoffMode *mode)
+{
+  for (size_t i = 0; i < sizeof(handoffNames) / sizeof(handoffNames[0]); i++)
+  {
+    if (strcmp(name, handoffNames[i]) == 0)
+    {
+      *mode = (HandoffMode)i;
+      return NO_ERROR;
+    }
+  }
+
+  return INVALID_ARGUMENT_ERROR;
+}
+
+/**
+ * @brief Get name of handoff mode
+ */
+const char *handoffName(HandoffMode mode)
+{
+  return handoffNames[mode];
+}
+
+/**
+ * @brief Wait on semaphore @p sem of SemHolder
+ *
+ * Semaphore enters kernel only when it has to block, so with report only blocking
+ * wait is counted as futex syscall and blocked process is registered for handoffPost()
+ */
+void handoffWait(sem_t *sem)
+{
+  if (!ctx->params.report || sem_trywait(sem) == 0)
+  {
+    if (!ctx->params.report)
+      SEM_WAIT(sem);
+    return;
+  }
+
+  __atomic_add_fetch(&SEM_WAITERS(sem), 1, __ATOMIC_SEQ_CST);
+  COUNT_SYSCALL();
+  SEM_WAIT(sem);
+  __atomic_sub_fetch(&SEM_WAITERS(sem), 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Post semaphore @p sem of SemHolder, post is futex syscall only when someone is blocked on it
+ */
+static void handoffPost(sem_t *sem)
+{
+  if (ctx->params.report && __atomic_load_n(&SEM_WAITERS(sem), __ATOMIC_SEQ_CST) > 0)
+    COUNT_SYSCALL();
+  sem_post(sem);
+}
+
+/**
+ * @brief Wait on process shared futex while it holds @p value
+ */
+static void futexWait(volatile uint32_t *addr, uint32_t value)
+{
+  COUNT_SYSCALL();
+  syscall(SYS_futex, addr, FUTEX_WAIT, value, NULL, NULL, 0);
+}
+
+/**
+ * @brief Wake up to @p count waiters of process shared futex
+ */
+static void futexWake(volatile uint32_t *addr, int count)
+{
+  COUNT_SYSCALL();
+  syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+/**
+ * @brief Enter group waiting for help, wake Santa when group is complete and wait until Santa helps
+ *
+ * Returns without help when workshop was closed, caller checks shopClosed
+ */
+void joinGroup()
+{
+  handoffWait(&ctx->semHolder->elfQueueMutex);
+
+  if (ctx->params.handoff == HANDOFF_GROUP && ctx->sharedMemory->shopClosed)
+  {
+    handoffPost(&ctx->semHolder->elfQueueMutex);
+    return;
+  }
+
+  ctx->sharedMemory->elfReadyQueue++;
+  uint32_t generation = ctx->sharedMemory->helpGeneration;
+
+  // Wake Santa if third in queue
+  if (ctx->sharedMemory->elfReadyQueue >= WORKSHOP_SEATS)
+  {
+    ctx->sharedMemory->wakeRequested = monotonicTime();
+    handoffPost(&ctx->semHolder->wakeForHelp);
+  }
+  handoffPost(&ctx->semHolder->elfQueueMutex);
+
+  if (ctx->params.handoff == HANDOFF_GROUP)
+  {
+    while (__atomic_load_n(&ctx->sharedMemory->helpGeneration, __ATOMIC_ACQUIRE) == generation)
+      futexWait(&ctx->sharedMemory->helpGeneration, generation);
+    return;
+  }
+
+  // Wait for help
+  handoffWait(&ctx->semHolder->waitForHelp);
+
+  handoffWait(&ctx->semHolder->elfQueueMutex);
+  ctx->sharedMemory->elfReadyQueue--;
+  handoffPost(&ctx->semHolder->elfQueueMutex);
+}
+
+/**
+ * @brief Signal that elf got help, last elf of group frees workshop for next elves
+ */
+void leaveGroup()
+{
+  if (ctx->params.handoff == HANDOFF_GROUP)
+  {
+    if (__atomic_sub_fetch(&ctx->sharedMemory->groupRemaining, 1, __ATOMIC_ACQ_REL) != 0)
+      return;
+
+    // Last elf of group lets next elves in and wakes Santa
+    handoffWait(&ctx->semHolder->elfQueueMutex);
+    ctx->sharedMemory->elfReadyQueue -= WORKSHOP_SEATS;
+    releaseSeats();
+    handoffPost(&ctx->semHolder->elfQueueMutex);
+
+    __atomic_add_fetch(&ctx->sharedMemory->groupsDone, 1, __ATOMIC_RELEASE);
+    futexWake(&ctx->sharedMemory->groupsDone, 1);
+    return;
+  }
+
+  // Get help from Santa
+  handoffPost(&ctx->semHolder->elfHelped);
+
+  // Signal to 3 next elves that workshop is free
+  handoffWait(&ctx->semHolder->elfQueueMutex);
+  if (ctx->sharedMemory->elfReadyQueue == 0)
+  {
+    releaseSeats();
+  }
+  handoffPost(&ctx->semHolder->elfQueueMutex);
+}
+
+/**
+ * @brief Help group of elves and wait until all of them got help
+ */
+void serveGroup()
+{
+  if (ctx->params.handoff == HANDOFF_GROUP)
+  {
+    uint32_t done = __atomic_load_n(&ctx->sharedMemory->groupsDone, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(&ctx->sharedMemory->groupRemaining, WORKSHOP_SEATS, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&ctx->sharedMemory->helpGeneration, 1, __ATOMIC_RELEASE);
+    futexWake(&ctx->sharedMemory->helpGeneration, INT_MAX);
+
+    while (__atomic_load_n(&ctx->sharedMemory->groupsDone, __ATOMIC_ACQUIRE) == done)
+      futexWait(&ctx->sharedMemory->groupsDone, done);
+  }
+  else
+  {
+    for(size_t i = 0; i < WORKSHOP_SEATS; i++)
+    {
+      handoffPost(&ctx->semHolder->waitForHelp);
+    }
+
+    for(size_t i = 0; i < WORKSHOP_SEATS; i++)
+    {
+      handoffWait(&ctx->semHolder->elfHelped);
+    }
+
+  }
+
+  ctx->sharedMemory->groupsServed++;
+}
+
+/**
+ * @brief Release all elves waiting for help after workshop was closed
+ *
+ * @param elves number of elves in workshop
+ */
+void closeGroups(size_t elves)
+{
+  if (ctx->params.handoff == HANDOFF_GROUP)
+  {
+    // Generation is changed under mutex so no elf can start waiting on old one
+    handoffWait(&ctx->semHolder->elfQueueMutex);
+    __atomic_add_fetch(&ctx->sharedMemory->helpGeneration, 1, __ATOMIC_RELEASE);
+    handoffPost(&ctx->semHolder->elfQueueMutex);
+
+    futexWake(&ctx->sharedMemory->helpGeneration, INT_MAX);
+    return;
+  }
+
+  for (size_t i = 0; i < elves; i++)
+    handoffPost(&ctx->semHolder->waitForHelp);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file handoff.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for handing groups of elves between Santa and elves
+ */
+
+#ifndef IOS_PROJECT2_HANDOFF_H
+#define IOS_PROJECT2_HANDOFF_H
+
+#include <semaphore.h>
+#include <stdint.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "admission.h"
+#include "timing.h"
+#include "probes.h"
+
+ReturnCode parseHandoff(const char *name, HandoffMode *mode);
+const char *handoffName(HandoffMode mode);
+void handoffWait(sem_t *sem);
+
+void joinGroup();
+void leaveGroup();
+void serveGroup();
+void closeGroups(size_t elves);
+
+#endif //IOS_PROJECT2_HANDOFF_H
@@ -0,0 +1,96 @@
+/**
+ * @file latency.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Log-linear latency histograms shared between processes
+ *
+ * Values are split to power of two ranges, each divided to LATENCY_SUB_BUCKETS linear buckets,
+ * so relative error of percentile is below 1/LATENCY_SUB_BUCKETS.
+ */
+
+#include "latency.h"
+
+/**
+ * @brief Get index of bucket for value @p ns
+ */
+static int bucketIndex(int64_t ns)
+{
+  if (ns < LATENCY_SUB_BUCKETS) return (int)(ns < 0 ? 0 : ns);
+
+  int exponent = 63 - __builtin_clzll((unsigned long long)ns);
+  int shift = exponent - LATENCY_SUB_BITS;
+  int index = (shift + 1) * LATENCY_SUB_BUCKETS + (int)((ns >> shift) - LATENCY_SUB_BUCKETS);
+
+  return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+/**
+ * @brief Get upper bound of values in bucket with @p index
+ */
+static int64_t bucketValue(int index)
+{
+  if (index < LATENCY_SUB_BUCKETS) return index;
+
+  int shift = index / LATENCY_SUB_BUCKETS - 1;
+  int64_t base = (int64_t)(index % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS) << shift;
+
+  return base + ((int64_t)1 << shift) - 1;
+}
+
+/**
+ * @brief Atomically add one value to histogram
+ *
+ * @param histogram histogram in shared memory
+ * @param ns value in nanoseconds
+ */
+void histogramAdd(LatencyHistogram *histogram, int64_t ns)
+{
+  __atomic_add_fetch(&histogram->buckets[bucketIndex(ns)], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&histogram->total, ns, __ATOMIC_RELAXED);
+
+  int64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+  while (ns > max && !__atomic_compare_exchange_n(&histogram->max, &max, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Add all values from @p source to @p target
+ */
+void histogramMerge(LatencyHistogram *target, const LatencyHistogram *source)
+{
+  for (int i = 0; i < LATENCY_BUCKETS; i++)
+    target->buckets[i] += source->buckets[i];
+
+  target->count += source->count;
+  target->total += source->total;
+  if (source->max > target->max)
+    target->max = source->max;
+}
+
+/**
+ * @brief Get value under which @p percentile percent of values lies
+ *
+ * @param histogram histogram to read
+ * @param percentile percentile from interval (0, 100>
+ * @return value in nanoseconds, 0 for empty histogram
+ */
+int64_t histogramPercentile(const LatencyHistogram *histogram, double percentile)
+{
+  if (histogram->count == 0) return 0;
+
+  int64_t rank = (int64_t)(percentile / 100.0 * histogram->count + 0.5);
+  if (rank < 1) rank = 1;
+
+  int64_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++)
+  {
+    seen += histogram->buckets[i];
+    if (seen >= rank)
+    {
+      int64_t value = bucketValue(i);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
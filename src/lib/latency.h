@@ -0,0 +1,19 @@
+/**
+ * @file latency.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for latency histograms
+ */
+
+#ifndef IOS_PROJECT2_LATENCY_H
+#define IOS_PROJECT2_LATENCY_H
+
+#include <stdint.h>
+
+#include "static_constructions.h"
+
+void histogramAdd(LatencyHistogram *histogram, int64_t ns);
+void histogramMerge(LatencyHistogram *target, const LatencyHistogram *source);
+int64_t histogramPercentile(const LatencyHistogram *histogram, double percentile);
+
+#endif //IOS_PROJECT2_LATENCY_H
@@ -0,0 +1,298 @@
+/**
+ * @file net_client.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Client hosting elves and reindeers of remote Santa
+ *
+ * All entities of client are driven by one event loop, deadlines of working elves and
+ * reindeers on vacation are kept in binary heap. Records produced in one iteration of loop
+ * are written to server by one system call.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "net_client.h"
+
+/**
+ * @struct net_timer
+ * @brief Deadline of one entity, entities below ne are elves, others reindeers
+ */
+typedef struct net_timer
+{
+  int64_t deadline;               /**< CLOCK_MONOTONIC time in nanoseconds */
+  uint32_t entity;                /**< Index of entity */
+} NetTimer;
+
+/**
+ * @struct net_host
+ * @brief State of client
+ */
+typedef struct net_host
+{
+  int fd;                         /**< Socket connected to server */
+  NetBuffer output;               /**< Records waiting for write */
+  char input[NET_INPUT_SIZE];     /**< Received bytes not processed yet */
+  size_t inputUsed;               /**< Number of bytes in input */
+  uint32_t firstElf;              /**< Id of first hosted elf */
+  uint32_t firstRd;               /**< Id of first hosted reindeer */
+  NetTimer *timers;               /**< Binary heap of deadlines */
+  size_t timerCount;              /**< Number of deadlines in heap */
+  size_t remaining;               /**< Number of entities that didn't finish */
+} NetHost;
+
+static NetHost host;
+
+/**
+ * @brief Add deadline of @p entity after @p us microseconds scaled by time scale
+ */
+static void scheduleEntity(uint32_t entity, int us)
+{
+  NetTimer timer = { monotonicTime() + (int64_t)(us * ctx->params.timeScale * NSEC_PER_USEC), entity };
+
+  size_t i = host.timerCount++;
+  while (i > 0 && host.timers[(i - 1) / 2].deadline > timer.deadline)
+  {
+    host.timers[i] = host.timers[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  host.timers[i] = timer;
+}
+
+/**
+ * @brief Remove earliest deadline from heap
+ */
+static NetTimer popTimer()
+{
+  NetTimer top = host.timers[0];
+  NetTimer last = host.timers[--host.timerCount];
+
+  size_t i = 0;
+  while (2 * i + 1 < host.timerCount)
+  {
+    size_t child = 2 * i + 1;
+    if (child + 1 < host.timerCount && host.timers[child + 1].deadline < host.timers[child].deadline)
+      child++;
+    if (last.deadline <= host.timers[child].deadline)
+      break;
+
+    host.timers[i] = host.timers[child];
+    i = child;
+  }
+  host.timers[i] = last;
+
+  return top;
+}
+
+/**
+ * @brief Send records of all entities whose deadline passed
+ */
+static ReturnCode fireTimers()
+{
+  int64_t now = monotonicTime();
+  bool queued = true;
+
+  while (host.timerCount > 0 && host.timers[0].deadline <= now)
+  {
+    NetTimer timer = popTimer();
+
+    if (timer.entity < (uint32_t)ctx->params.ne)
+      queued &= netQueue(&host.output, NET_ELF_NEED_HELP, host.firstElf + timer.entity, 0);
+    else
+      queued &= netQueue(&host.output, NET_RD_RETURN, host.firstRd + timer.entity - ctx->params.ne, 0);
+  }
+
+  return queued ? NO_ERROR : MEMORY_ALLOCATION_ERROR;
+}
+
+/**
+ * @brief Process one record received from server
+ */
+static ReturnCode processRecord(const NetRecord *record)
+{
+  switch (record->type)
+  {
+    case NET_ELF_HELPED:
+      // Elf works again
+      scheduleEntity(record->id - host.firstElf, randomDuration(0, ctx->params.te));
+      return NO_ERROR;
+
+    case NET_ELF_HOLIDAYS:
+    case NET_RD_HITCHED:
+      host.remaining--;
+      return NO_ERROR;
+
+    default:
+      return NETWORK_ERROR;
+  }
+}
+
+/**
+ * @brief Read available records from server and process them
+ */
+static ReturnCode receive()
+{
+  while (host.remaining > 0)
+  {
+    ssize_t received = read(host.fd, host.input + host.inputUsed, NET_INPUT_SIZE - host.inputUsed);
+    if (received == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return NO_ERROR;
+      return NETWORK_ERROR;
+    }
+
+    // Server can't leave before all hosted entities finished
+    if (received == 0)
+      return NETWORK_ERROR;
+
+    host.inputUsed += received;
+
+    size_t offset = 0;
+    for (; offset + NET_RECORD_SIZE <= host.inputUsed; offset += NET_RECORD_SIZE)
+    {
+      NetRecord record;
+      netDecode(host.input + offset, &record);
+      if (processRecord(&record) != NO_ERROR)
+        return NETWORK_ERROR;
+    }
+
+    memmove(host.input, host.input + offset, host.inputUsed - offset);
+    host.inputUsed -= offset;
+  }
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Register hosted entities at server and get their ids
+ */
+static ReturnCode handshake()
+{
+  if (!netQueue(&host.output, NET_HELLO, ctx->params.ne, ctx->params.nr))
+    return MEMORY_ALLOCATION_ERROR;
+
+  if (netFlush(host.fd, &host.output) != 1)
+    return NETWORK_ERROR;
+
+  char bytes[NET_RECORD_SIZE];
+  size_t received = 0;
+  while (received < NET_RECORD_SIZE)
+  {
+    ssize_t len = read(host.fd, bytes + received, NET_RECORD_SIZE - received);
+    if (len == -1 && errno == EINTR)
+      continue;
+    if (len <= 0)
+      return NETWORK_ERROR;
+    received += len;
+  }
+
+  NetRecord record;
+  netDecode(bytes, &record);
+  if (record.type != NET_WELCOME)
+    return NETWORK_ERROR;
+
+  host.firstElf = record.id;
+  host.firstRd = record.arg;
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Run hosted entities until all of them finished
+ */
+static ReturnCode eventLoop()
+{
+  ReturnCode retVal = NO_ERROR;
+
+  // Start all entities
+  for (uint32_t i = 0; i < (uint32_t)ctx->params.ne && retVal == NO_ERROR; i++)
+  {
+    if (!netQueue(&host.output, NET_ELF_START, host.firstElf + i, 0))
+      retVal = MEMORY_ALLOCATION_ERROR;
+    scheduleEntity(i, randomDuration(0, ctx->params.te));
+  }
+
+  for (uint32_t i = 0; i < (uint32_t)ctx->params.nr && retVal == NO_ERROR; i++)
+  {
+    if (!netQueue(&host.output, NET_RD_START, host.firstRd + i, 0))
+      retVal = MEMORY_ALLOCATION_ERROR;
+    scheduleEntity(ctx->params.ne + i, randomDuration(ctx->params.tr / 2, ctx->params.tr));
+  }
+
+  while (retVal == NO_ERROR && host.remaining > 0)
+  {
+    retVal |= fireTimers();
+
+    int flushed = netFlush(host.fd, &host.output);
+    if (flushed == -1)
+      return NETWORK_ERROR;
+
+    struct pollfd pfd = { .fd = host.fd, .events = POLLIN | (flushed == 0 ? POLLOUT : 0) };
+    struct timespec timeout = { 0 };
+    struct timespec *wait = NULL;
+
+    if (host.timerCount > 0)
+    {
+      int64_t left = host.timers[0].deadline - monotonicTime();
+      if (left < 0)
+        left = 0;
+
+      timeout.tv_sec = left / NSEC_PER_SEC;
+      timeout.tv_nsec = left % NSEC_PER_SEC;
+      wait = &timeout;
+    }
+
+    if (ppoll(&pfd, 1, wait, NULL) == -1 && errno != EINTR)
+      return NETWORK_ERROR;
+
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR))
+      retVal |= receive();
+  }
+
+  return retVal;
+}
+
+/**
+ * @brief Host elves and reindeers of remote Santa
+ *
+ * Params ne and nr are numbers of entities hosted by this client
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode runClient()
+{
+  memset(&host, 0, sizeof(host));
+  host.remaining = ctx->params.ne + ctx->params.nr;
+
+  host.timers = calloc(host.remaining, sizeof(NetTimer));
+  if (host.timers == NULL)
+    return MEMORY_ALLOCATION_ERROR;
+
+  host.fd = netConnect(ctx->params.connectAddress);
+  if (host.fd == -1)
+  {
+    free(host.timers);
+    return NETWORK_ERROR;
+  }
+
+  ReturnCode retVal = handshake();
+  if (retVal == NO_ERROR)
+  {
+    fcntl(host.fd, F_SETFL, fcntl(host.fd, F_GETFL) | O_NONBLOCK);
+    retVal = eventLoop();
+  }
+
+  close(host.fd);
+  netFreeBuffer(&host.output);
+  free(host.timers);
+
+  return retVal;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file net_client.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for client hosting elves and reindeers of remote Santa
+ */
+
+#ifndef IOS_PROJECT2_NET_CLIENT_H
+#define IOS_PROJECT2_NET_CLIENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "network.h"
+#include "timing.h"
+
+ReturnCode runClient();
+
+#endif //IOS_PROJECT2_NET_CLIENT_H
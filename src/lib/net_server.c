@@ -0,0 +1,484 @@
+/**
+ * @file net_server.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Santa server of remote elves and reindeers
+ *
+ * Santa, queue of elves and counter of returned reindeers live in one process which serves
+ * all clients from one epoll loop. Output is written by the same sink as in local simulation,
+ * so proj2.out has the same lines. Records of all clients are processed in batches and answers
+ * are written once per loop iteration.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "net_server.h"
+
+#define NET_MAX_EVENTS 64
+
+/**
+ * @brief States of remote entity, record from client is accepted only in matching state
+ */
+typedef enum net_entity_state
+{
+  NET_ENTITY_NEW = 0,             /**< Registered but not started */
+  NET_ENTITY_ACTIVE = 1,          /**< Elf works, reindeer is on vacation */
+  NET_ENTITY_WAITING = 2,         /**< Elf waits for help, reindeer returned and waits for hitch */
+  NET_ENTITY_DONE = 3,            /**< Elf takes holidays, reindeer got hitched */
+} NetEntityState;
+
+/**
+ * @struct net_client
+ * @brief Connection of one client hosting elves and reindeers
+ */
+typedef struct net_client
+{
+  int fd;                         /**< Socket of client */
+  char input[NET_INPUT_SIZE];     /**< Received bytes not processed yet */
+  size_t inputUsed;               /**< Number of bytes in input */
+  NetBuffer output;               /**< Records waiting for write */
+  size_t entities;                /**< Number of hosted entities that didn't finish yet */
+  bool writable;                  /**< Socket is watched for EPOLLOUT */
+  bool closed;                    /**< Client disconnected and will be freed after current batch */
+  struct net_client *next;        /**< Next connected client */
+} NetClient;
+
+/**
+ * @struct net_server
+ * @brief State of Santa server
+ */
+typedef struct net_server
+{
+  int epollFd;                    /**< Epoll instance of server loop */
+  int listenFd;                   /**< Listening socket */
+  NetClient *clients;             /**< List of connected clients */
+  NetClient **elfOwner;           /**< Client hosting elf indexed by id */
+  NetClient **rdOwner;            /**< Client hosting reindeer indexed by id */
+  uint8_t *elfState;              /**< NetEntityState of elf indexed by id */
+  uint8_t *rdState;               /**< NetEntityState of reindeer indexed by id */
+  int64_t *needHelpTime;          /**< Time of last help request of elf indexed by id */
+  uint32_t *queue;                /**< Ring buffer of elves waiting for help */
+  size_t queueHead;               /**< Index of first waiting elf */
+  size_t queueLength;             /**< Number of waiting elves */
+  uint32_t elves;                 /**< Number of assigned elf ids */
+  uint32_t reindeers;             /**< Number of assigned reindeer ids */
+  int readyRDCount;               /**< Number of returned reindeers */
+  size_t finished;                /**< Number of finished entities */
+} NetServer;
+
+static NetServer server;
+
+/**
+ * @brief Queue record for @p client, errors are found when queue of client is flushed
+ */
+static ReturnCode reply(NetClient *client, uint32_t type, uint32_t id, uint32_t arg)
+{
+  return netQueue(&client->output, type, id, arg) ? NO_ERROR : MEMORY_ALLOCATION_ERROR;
+}
+
+/**
+ * @brief Finish elf or reindeer hosted by @p client
+ */
+static ReturnCode finishEntity(NetClient *client, uint32_t type, uint32_t id)
+{
+  client->entities--;
+  server.finished++;
+  return reply(client, type, id, 0);
+}
+
+/**
+ * @brief Send elf on holidays
+ */
+static ReturnCode elfHolidays(uint32_t id)
+{
+  EMIT(EVENT_ELF_HOLIDAYS, "Elf", (int)id, "taking holidays");
+  server.elfState[id] = NET_ENTITY_DONE;
+  return finishEntity(server.elfOwner[id], NET_ELF_HOLIDAYS, id);
+}
+
+/**
+ * @brief Santa helps groups of elves while enough of them waits and workshop is open
+ */
+static ReturnCode serveElves()
+{
+  ReturnCode retVal = NO_ERROR;
+
+  while (!ctx->sharedMemory->shopClosed && server.queueLength >= WORKSHOP_SEATS)
+  {
+    EMIT(EVENT_SANTA_HELP, "Santa", NO_ID, "helping elves");
+
+    for (size_t i = 0; i < WORKSHOP_SEATS; i++)
+    {
+      uint32_t id = server.queue[server.queueHead];
+      server.queueHead = (server.queueHead + 1) % ctx->params.ne;
+      server.queueLength--;
+
+      EMIT(EVENT_ELF_GET_HELP, "Elf", (int)id, "get help");
+      server.elfState[id] = NET_ENTITY_ACTIVE;
+      histogramAdd((LatencyHistogram *)&ctx->sharedMemory->waitLatency, monotonicTime() - server.needHelpTime[id]);
+      retVal |= reply(server.elfOwner[id], NET_ELF_HELPED, id, 0);
+    }
+
+    ctx->sharedMemory->groupsServed++;
+    STAT_ADD(groupsServed, 1);
+    EMIT(EVENT_SANTA_SLEEP, "Santa", NO_ID, "going to sleep");
+  }
+
+  return retVal;
+}
+
+/**
+ * @brief Close workshop after last reindeer returned, hitch reindeers and send waiting elves home
+ */
+static ReturnCode christmas()
+{
+  ReturnCode retVal = NO_ERROR;
+
+  // Every reindeer must be registered and returned
+  for (int id = 1; id <= ctx->params.nr; id++)
+  {
+    if (server.rdOwner[id] == NULL || server.rdState[id] != NET_ENTITY_WAITING)
+      return NETWORK_ERROR;
+  }
+
+  EMIT(EVENT_SANTA_CLOSING, "Santa", NO_ID, "closing workshop");
+  ctx->sharedMemory->shopClosed = true;
+
+  for (int id = 1; id <= ctx->params.nr; id++)
+  {
+    EMIT(EVENT_RD_HITCHED, "RD", id, "get hitched");
+    server.rdState[id] = NET_ENTITY_DONE;
+    retVal |= finishEntity(server.rdOwner[id], NET_RD_HITCHED, id);
+  }
+
+  EMIT(EVENT_SANTA_CHRISTMAS, "Santa", NO_ID, "Christmas started");
+  STAT_ADD(rdReturned, -ctx->params.nr);
+  STAT_ADD(seasons, 1);
+
+  while (server.queueLength > 0)
+  {
+    uint32_t id = server.queue[server.queueHead];
+    server.queueHead = (server.queueHead + 1) % ctx->params.ne;
+    server.queueLength--;
+
+    // Elf sent home from queue waited until closing
+    histogramAdd((LatencyHistogram *)&ctx->sharedMemory->waitLatency, monotonicTime() - server.needHelpTime[id]);
+    ctx->sharedMemory->elvesUnserved++;
+    retVal |= elfHolidays(id);
+
+  }
+
+  return retVal;
+}
+
+/**
+ * @brief Assign ids to entities of new client
+ */
+static ReturnCode registerClient(NetClient *client, uint32_t elves, uint32_t reindeers)
+{
+  if (elves > (uint32_t)ctx->params.ne - server.elves || reindeers > (uint32_t)ctx->params.nr - server.reindeers ||
+      elves + reindeers == 0 || client->entities > 0)
+    return reply(client, NET_REJECT, 0, 0);
+
+  for (uint32_t i = 1; i <= elves; i++)
+    server.elfOwner[server.elves + i] = client;
+  for (uint32_t i = 1; i <= reindeers; i++)
+    server.rdOwner[server.reindeers + i] = client;
+
+  ReturnCode retVal = reply(client, NET_WELCOME, server.elves + 1, server.reindeers + 1);
+
+  client->entities = elves + reindeers;
+  server.elves += elves;
+  server.reindeers += reindeers;
+
+  return retVal;
+}
+
+/**
+ * @brief Process one record received from @p client
+ */
+static ReturnCode processRecord(NetClient *client, const NetRecord *record)
+{
+  bool elfValid = record->id >= 1 && record->id <= server.elves && server.elfOwner[record->id] == client;
+  bool rdValid = record->id >= 1 && record->id <= server.reindeers && server.rdOwner[record->id] == client;
+
+  switch (record->type)
+  {
+    case NET_HELLO:
+      return registerClient(client, record->id, record->arg);
+
+    case NET_ELF_START:
+      if (!elfValid || server.elfState[record->id] != NET_ENTITY_NEW) return NETWORK_ERROR;
+      server.elfState[record->id] = NET_ENTITY_ACTIVE;
+      EMIT(EVENT_ELF_STARTED, "Elf", (int)record->id, "started");
+      return NO_ERROR;
+
+    case NET_ELF_NEED_HELP:
+      if (!elfValid || server.elfState[record->id] != NET_ENTITY_ACTIVE) return NETWORK_ERROR;
+      EMIT(EVENT_ELF_NEED_HELP, "Elf", (int)record->id, "need help");
+
+      if (ctx->sharedMemory->shopClosed)
+        return elfHolidays(record->id);
+
+      server.elfState[record->id] = NET_ENTITY_WAITING;
+      server.needHelpTime[record->id] = monotonicTime();
+      server.queue[(server.queueHead + server.queueLength) % ctx->params.ne] = record->id;
+      server.queueLength++;
+      return serveElves();
+
+    case NET_RD_START:
+      if (!rdValid || server.rdState[record->id] != NET_ENTITY_NEW) return NETWORK_ERROR;
+      server.rdState[record->id] = NET_ENTITY_ACTIVE;
+      EMIT(EVENT_RD_STARTED, "RD", (int)record->id, "rstarted");
+      return NO_ERROR;
+
+    case NET_RD_RETURN:
+      if (!rdValid || server.rdState[record->id] != NET_ENTITY_ACTIVE) return NETWORK_ERROR;
+      server.rdState[record->id] = NET_ENTITY_WAITING;
+      ctx->sharedMemory->readyRDCount++;
+      STAT_ADD(rdReturned, 1);
+      EMIT(EVENT_RD_RETURN, "RD", (int)record->id, "return home");
+
+      if (ctx->sharedMemory->readyRDCount == ctx->params.nr)
+        return christmas();
+      return NO_ERROR;
+
+    default:
+      return NETWORK_ERROR;
+  }
+}
+
+/**
+ * @brief Read available records of @p client and process them
+ *
+ * @return NO_ERROR, NETWORK_ERROR when client misbehaves or disconnects with running entities
+ */
+static ReturnCode receive(NetClient *client)
+{
+  ReturnCode retVal = NO_ERROR;
+
+  while (retVal == NO_ERROR)
+  {
+    ssize_t received = read(client->fd, client->input + client->inputUsed, NET_INPUT_SIZE - client->inputUsed);
+    if (received == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      return NETWORK_ERROR;
+    }
+
+    if (received == 0)
+    {
+      client->closed = true;
+      return (client->entities > 0) ? NETWORK_ERROR : NO_ERROR;
+    }
+
+    client->inputUsed += received;
+
+    size_t offset = 0;
+    for (; offset + NET_RECORD_SIZE <= client->inputUsed && retVal == NO_ERROR; offset += NET_RECORD_SIZE)
+    {
+      NetRecord record;
+      netDecode(client->input + offset, &record);
+      retVal |= processRecord(client, &record);
+    }
+
+    memmove(client->input, client->input + offset, client->inputUsed - offset);
+    client->inputUsed -= offset;
+  }
+
+  return retVal;
+}
+
+/**
+ * @brief Flush queued records of all clients, sockets that are full are watched for EPOLLOUT
+ */
+static ReturnCode flushClients()
+{
+  for (NetClient *client = server.clients; client != NULL; client = client->next)
+  {
+    int flushed = netFlush(client->fd, &client->output);
+    if (flushed == -1)
+      return NETWORK_ERROR;
+
+    bool writable = (flushed == 0);
+    if (writable != client->writable)
+    {
+      struct epoll_event event = { .events = EPOLLIN | (writable ? EPOLLOUT : 0), .data.ptr = client };
+      epoll_ctl(server.epollFd, EPOLL_CTL_MOD, client->fd, &event);
+      client->writable = writable;
+    }
+  }
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Accept all pending clients
+ */
+static ReturnCode acceptClients()
+{
+  int fd;
+  while ((fd = netAccept(server.listenFd)) != -1)
+  {
+    NetClient *client = calloc(1, sizeof(NetClient));
+    if (client == NULL)
+    {
+      close(fd);
+      return MEMORY_ALLOCATION_ERROR;
+    }
+
+    client->fd = fd;
+    client->next = server.clients;
+    server.clients = client;
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+    if (epoll_ctl(server.epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+      return NETWORK_ERROR;
+  }
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Disconnect @p client and free it
+ */
+static void dropClient(NetClient *client)
+{
+  for (NetClient **it = &server.clients; *it != NULL; it = &(*it)->next)
+  {
+    if (*it == client)
+    {
+      *it = client->next;
+      break;
+    }
+  }
+
+  close(client->fd);
+  netFreeBuffer(&client->output);
+  free(client);
+}
+
+/**
+ * @brief Release all memory and sockets of server
+ */
+static void closeServer()
+{
+  while (server.clients != NULL)
+  {
+    // Let clients receive last answers
+    int flags = fcntl(server.clients->fd, F_GETFL);
+    fcntl(server.clients->fd, F_SETFL, flags & ~O_NONBLOCK);
+    netFlush(server.clients->fd, &server.clients->output);
+    dropClient(server.clients);
+  }
+
+  if (server.listenFd != -1)
+  {
+    close(server.listenFd);
+    netUnlink(ctx->params.serveAddress);
+  }
+  if (server.epollFd != -1)
+    close(server.epollFd);
+
+  free(server.elfOwner);
+  free(server.rdOwner);
+  free(server.elfState);
+  free(server.rdState);
+  free(server.needHelpTime);
+  free(server.queue);
+}
+
+/**
+ * @brief Serve remote elves and reindeers until all of them finished
+ *
+ * Params ne and nr are total numbers of entities of all clients
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode runServer()
+{
+  memset(&server, 0, sizeof(server));
+  server.epollFd = server.listenFd = -1;
+
+  // Open output sink
+  ReturnCode retVal = openWorkshopSink(0);
+  if (retVal != NO_ERROR)
+    return retVal;
+
+  server.elfOwner = calloc(ctx->params.ne + 1, sizeof(NetClient *));
+  server.rdOwner = calloc(ctx->params.nr + 1, sizeof(NetClient *));
+  server.elfState = calloc(ctx->params.ne + 1, sizeof(uint8_t));
+  server.rdState = calloc(ctx->params.nr + 1, sizeof(uint8_t));
+  server.needHelpTime = calloc(ctx->params.ne + 1, sizeof(int64_t));
+  server.queue = calloc(ctx->params.ne, sizeof(uint32_t));
+  if (server.elfOwner == NULL || server.rdOwner == NULL || server.elfState == NULL || server.rdState == NULL ||
+      server.needHelpTime == NULL || server.queue == NULL)
+  {
+    closeServer();
+    return MEMORY_ALLOCATION_ERROR;
+  }
+
+  server.listenFd = netListen(ctx->params.serveAddress);
+  server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (server.listenFd == -1 || server.epollFd == -1)
+  {
+    closeServer();
+    return NETWORK_ERROR;
+  }
+
+  struct epoll_event listenEvent = { .events = EPOLLIN, .data.ptr = NULL };
+  epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.listenFd, &listenEvent);
+
+  ctx->sharedMemory->startTime = monotonicTime();
+  EMIT(EVENT_SANTA_SLEEP, "Santa", NO_ID, "going to sleep");
+
+  struct epoll_event events[NET_MAX_EVENTS];
+
+  while (retVal == NO_ERROR && server.finished < (size_t)ctx->params.ne + ctx->params.nr)
+  {
+    int count = epoll_wait(server.epollFd, events, NET_MAX_EVENTS, -1);
+    if (count == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      retVal = NETWORK_ERROR;
+      break;
+    }
+
+    for (int i = 0; i < count && retVal == NO_ERROR; i++)
+    {
+      NetClient *client = events[i].data.ptr;
+      if (client == NULL)
+      {
+        retVal |= acceptClients();
+        continue;
+      }
+
+      if (!client->closed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        retVal |= receive(client);
+    }
+
+    // Free disconnected clients after whole batch was processed
+    NetClient *client = server.clients;
+    while (client != NULL)
+    {
+      NetClient *next = client->next;
+      if (client->closed)
+        dropClient(client);
+      client = next;
+    }
+
+    if (retVal == NO_ERROR)
+      retVal |= flushClients();
+  }
+
+  closeServer();
+  return retVal;
+}
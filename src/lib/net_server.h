@@ -0,0 +1,27 @@
+/**
+ * @file net_server.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for Santa server of remote elves and reindeers
+ */
+
+#ifndef IOS_PROJECT2_NET_SERVER_H
+#define IOS_PROJECT2_NET_SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "network.h"
+#include "utils.h"
+#include "admission.h"
+#include "output_sink.h"
+#include "events.h"
+#include "latency.h"
+#include "statistics.h"
+#include "timing.h"
+
+ReturnCode runServer();
+
+#endif //IOS_PROJECT2_NET_SERVER_H
@@ -0,0 +1,309 @@
+/**
+ * @file network.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Sockets and records of network protocol
+ *
+ * Addresses are "unix:PATH" for Unix domain sockets and "tcp:HOST:PORT" or "HOST:PORT" for TCP,
+ * empty host listens on all interfaces. Records have fixed size, so they are pipelined without
+ * framing and many of them are written by one system call.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "network.h"
+
+#define NET_UNIX_PREFIX "unix:"
+#define NET_TCP_PREFIX "tcp:"
+
+/**
+ * @brief Fill Unix socket address from @p path
+ *
+ * @return true if path fits into address
+ */
+static bool unixAddress(const char *path, struct sockaddr_un *addr)
+{
+  if (path[0] == 0 || strlen(path) >= sizeof(addr->sun_path))
+    return false;
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+  return true;
+}
+
+/**
+ * @brief Resolve TCP address "HOST:PORT"
+ *
+ * @param address address without prefix
+ * @param passive resolve address for listening
+ * @return list of addresses to be freed by freeaddrinfo or NULL
+ */
+static struct addrinfo *tcpAddress(const char *address, bool passive)
+{
+  const char *colon = strrchr(address, ':');
+  if (colon == NULL || colon[1] == 0)
+    return NULL;
+
+  char host[256];
+  size_t hostLen = colon - address;
+  if (hostLen >= sizeof(host))
+    return NULL;
+
+  memcpy(host, address, hostLen);
+  host[hostLen] = 0;
+
+  struct addrinfo hints = { 0 };
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+  struct addrinfo *result = NULL;
+  if (getaddrinfo(hostLen > 0 ? host : NULL, colon + 1, &hints, &result) != 0)
+    return NULL;
+
+  return result;
+}
+
+/**
+ * @brief Check format of network address
+ */
+bool isNetAddress(const char *address)
+{
+  if (strncmp(address, NET_UNIX_PREFIX, strlen(NET_UNIX_PREFIX)) == 0)
+  {
+    struct sockaddr_un addr;
+    return unixAddress(address + strlen(NET_UNIX_PREFIX), &addr);
+  }
+
+  if (strncmp(address, NET_TCP_PREFIX, strlen(NET_TCP_PREFIX)) == 0)
+    address += strlen(NET_TCP_PREFIX);
+
+  const char *colon = strrchr(address, ':');
+  return colon != NULL && colon[1] != 0;
+}
+
+/**
+ * @brief Disable batching delay of TCP, records are batched by caller
+ */
+static void setNoDelay(int fd)
+{
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * @brief Open listening socket on @p address
+ *
+ * @return file descriptor of socket or -1
+ */
+int netListen(const char *address)
+{
+  if (strncmp(address, NET_UNIX_PREFIX, strlen(NET_UNIX_PREFIX)) == 0)
+  {
+    struct sockaddr_un addr;
+    if (!unixAddress(address + strlen(NET_UNIX_PREFIX), &addr))
+      return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+      return -1;
+
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1)
+    {
+      close(fd);
+      return -1;
+    }
+
+    return fd;
+  }
+
+  if (strncmp(address, NET_TCP_PREFIX, strlen(NET_TCP_PREFIX)) == 0)
+    address += strlen(NET_TCP_PREFIX);
+
+  struct addrinfo *list = tcpAddress(address, true);
+  int fd = -1;
+
+  for (struct addrinfo *ai = list; ai != NULL && fd == -1; ai = ai->ai_next)
+  {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd == -1)
+      continue;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(fd, ai->ai_addr, ai->ai_addrlen) == -1 || listen(fd, SOMAXCONN) == -1)
+    {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  if (list != NULL)
+    freeaddrinfo(list);
+
+  return fd;
+}
+
+/**
+ * @brief Accept pending connection as non-blocking socket
+ *
+ * @return file descriptor of connected socket or -1
+ */
+int netAccept(int listenFd)
+{
+  int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd != -1)
+    setNoDelay(fd);
+
+  return fd;
+}
+
+/**
+ * @brief Connect to server listening on @p address
+ *
+ * @return file descriptor of connected socket or -1
+ */
+int netConnect(const char *address)
+{
+  if (strncmp(address, NET_UNIX_PREFIX, strlen(NET_UNIX_PREFIX)) == 0)
+  {
+    struct sockaddr_un addr;
+    if (!unixAddress(address + strlen(NET_UNIX_PREFIX), &addr))
+      return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+      return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+      close(fd);
+      return -1;
+    }
+
+    return fd;
+  }
+
+  if (strncmp(address, NET_TCP_PREFIX, strlen(NET_TCP_PREFIX)) == 0)
+    address += strlen(NET_TCP_PREFIX);
+
+  struct addrinfo *list = tcpAddress(address, false);
+  int fd = -1;
+
+  for (struct addrinfo *ai = list; ai != NULL && fd == -1; ai = ai->ai_next)
+  {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd == -1)
+      continue;
+
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == -1)
+    {
+      close(fd);
+      fd = -1;
+    }
+    else
+      setNoDelay(fd);
+  }
+
+  if (list != NULL)
+    freeaddrinfo(list);
+
+  return fd;
+}
+
+/**
+ * @brief Remove socket file of Unix domain socket @p address
+ */
+void netUnlink(const char *address)
+{
+  if (strncmp(address, NET_UNIX_PREFIX, strlen(NET_UNIX_PREFIX)) == 0)
+    unlink(address + strlen(NET_UNIX_PREFIX));
+}
+
+/**
+ * @brief Encode record to end of @p buffer
+ *
+ * @return false if buffer can't grow
+ */
+bool netQueue(NetBuffer *buffer, uint32_t type, uint32_t id, uint32_t arg)
+{
+  if (buffer->used + NET_RECORD_SIZE > buffer->capacity)
+  {
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : NET_INPUT_SIZE;
+    char *data = realloc(buffer->data, capacity);
+    if (data == NULL)
+      return false;
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+
+  uint32_t words[3] = { htonl(type), htonl(id), htonl(arg) };
+  memcpy(buffer->data + buffer->used, words, NET_RECORD_SIZE);
+  buffer->used += NET_RECORD_SIZE;
+
+  return true;
+}
+
+/**
+ * @brief Write as much of @p buffer as socket accepts
+ *
+ * @return 1 if whole buffer was written, 0 if part remains, -1 on error
+ */
+int netFlush(int fd, NetBuffer *buffer)
+{
+  while (buffer->sent < buffer->used)
+  {
+    ssize_t written = send(fd, buffer->data + buffer->sent, buffer->used - buffer->sent, MSG_NOSIGNAL);
+    if (written == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+      return -1;
+    }
+
+    buffer->sent += written;
+  }
+
+  buffer->used = 0;
+  buffer->sent = 0;
+  return 1;
+}
+
+/**
+ * @brief Decode one record from @p bytes
+ */
+void netDecode(const char *bytes, NetRecord *record)
+{
+  uint32_t words[3];
+  memcpy(words, bytes, NET_RECORD_SIZE);
+
+  record->type = ntohl(words[0]);
+  record->id = ntohl(words[1]);
+  record->arg = ntohl(words[2]);
+}
+
+/**
+ * @brief Free memory of @p buffer
+ */
+void netFreeBuffer(NetBuffer *buffer)
+{
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->used = buffer->sent = buffer->capacity = 0;
+}
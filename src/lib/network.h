@@ -0,0 +1,31 @@
+/**
+ * @file network.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for sockets and records of network protocol
+ */
+
+#ifndef IOS_PROJECT2_NETWORK_H
+#define IOS_PROJECT2_NETWORK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "static_constructions.h"
+
+#define NET_INPUT_SIZE (64 * 1024)      /**< Size of buffer for received records */
+#define NET_MAX_ELVES 1000000           /**< Max number of elves served over network */
+#define NET_MAX_RDS 100000              /**< Max number of reindeers served over network */
+
+bool isNetAddress(const char *address);
+int netListen(const char *address);
+int netAccept(int listenFd);
+int netConnect(const char *address);
+void netUnlink(const char *address);
+bool netQueue(NetBuffer *buffer, uint32_t type, uint32_t id, uint32_t arg);
+int netFlush(int fd, NetBuffer *buffer);
+void netDecode(const char *bytes, NetRecord *record);
+void netFreeBuffer(NetBuffer *buffer);
+
+#endif //IOS_PROJECT2_NETWORK_H
@@ -0,0 +1,261 @@
+/**
+ * @file output_sink.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Output sinks for simulation lines
+ *
+ * Spec of sink is one of: file:PATH, stdout, pipe:COMMAND, memory[:BYTES], null
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "output_sink.h"
+#include "placement.h"
+
+/**
+ * @brief Parse sink spec from argument and store it to @p prm
+ *
+ * @param spec sink specification
+ * @param prm parameters to update
+ * @return ReturnCode with NO_ERROR if it was successful or INVALID_ARGUMENT_ERROR
+ */
+ReturnCode parseSinkSpec(const char *spec, Params *prm)
+{
+  if (strncmp(spec, "file:", 5) == 0 && spec[5] != 0)
+  {
+    prm->sinkType = SINK_FILE;
+    prm->sinkTarget = (char *)spec + 5;
+  }
+  else if (strcmp(spec, "stdout") == 0)
+  {
+    prm->sinkType = SINK_STDOUT;
+  }
+  else if (strncmp(spec, "pipe:", 5) == 0 && spec[5] != 0)
+  {
+    prm->sinkType = SINK_PIPE;
+    prm->sinkTarget = (char *)spec + 5;
+  }
+  else if (strcmp(spec, "memory") == 0)
+  {
+    prm->sinkType = SINK_MEMORY;
+    prm->sinkMemorySize = SINK_DEFAULT_MEMORY_SIZE;
+  }
+  else if (strncmp(spec, "memory:", 7) == 0)
+  {
+    char *rest = NULL;
+    long long size = strtoll(spec + 7, &rest, 10);
+    if (*rest != 0 || size <= 0) return INVALID_ARGUMENT_ERROR;
+
+    prm->sinkType = SINK_MEMORY;
+    prm->sinkMemorySize = (size_t)size;
+  }
+  else if (strcmp(spec, "null") == 0)
+  {
+    prm->sinkType = SINK_NULL;
+  }
+  else
+    return INVALID_ARGUMENT_ERROR;
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Spawn consumer command of pipe sink
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+static ReturnCode spawnConsumer()
+{
+  int fds[2];
+  if (pipe(fds) == -1)
+    return PIPE_CREATE_ERROR;
+
+  ctx->outputSink.consumerId = fork();
+  if (ctx->outputSink.consumerId < 0)
+  {
+    ctx->outputSink.consumerId = 0;
+    close(fds[0]);
+    close(fds[1]);
+    return PROCESS_CREATE_ERROR;
+  }
+  else if (ctx->outputSink.consumerId == 0)
+  {
+    signal(SIGPIPE, SIG_DFL);
+    placeLogger();
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    execl("/bin/sh", "sh", "-c", ctx->params.sinkTarget, (char *)NULL);
+    _exit(127);
+  }
+
+  close(fds[0]);
+  ctx->outputSink.fd = fds[1];
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Open parts of sink shared by all workshops
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode openSink()
+{
+  // Consumer that exits early must not kill writers holding output lock
+  if (ctx->params.sinkType == SINK_STDOUT || ctx->params.sinkType == SINK_PIPE)
+    signal(SIGPIPE, SIG_IGN);
+
+  switch (ctx->params.sinkType)
+  {
+    case SINK_STDOUT:
+      ctx->outputSink.fd = STDOUT_FILENO;
+      break;
+
+    case SINK_PIPE:
+      return spawnConsumer();
+
+    case SINK_MEMORY:
+    {
+      void *mem = mmap(NULL, sizeof(MemorySink) + ctx->params.sinkMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if (mem == MAP_FAILED)
+        return SM_CREATE_ERROR;
+
+      ctx->outputSink.memory = mem;
+      ctx->outputSink.memory->capacity = ctx->params.sinkMemorySize;
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Close parts of sink shared by all workshops
+ *
+ * @param retVal pointer to return code that will be returned based on previous state and success of this action
+ */
+void closeSink(ReturnCode *retVal)
+{
+  if (ctx->params.sinkType == SINK_PIPE && ctx->outputSink.fd != -1)
+  {
+    close(ctx->outputSink.fd);
+    ctx->outputSink.fd = -1;
+  }
+
+  if (ctx->outputSink.consumerId != 0)
+  {
+    while (waitpid(ctx->outputSink.consumerId, NULL, 0) == -1 && errno == EINTR);
+    ctx->outputSink.consumerId = 0;
+  }
+
+  if (ctx->outputSink.memory != NULL)
+  {
+    if (munmap(ctx->outputSink.memory, sizeof(MemorySink) + ctx->outputSink.memory->capacity) == -1)
+      (*retVal) |= SM_DESTROY_ERROR;
+    ctx->outputSink.memory = NULL;
+  }
+
+  ctx->outputSink.fd = -1;
+}
+
+/**
+ * @brief Open part of sink private to workshop with @p index
+ *
+ * File sink of multiple workshops gets index inserted before extension (proj2.out -> proj2.1.out)
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode openWorkshopSink(size_t index)
+{
+  if (ctx->params.sinkType != SINK_FILE || ctx->params.sinkTarget == NULL)
+    return NO_ERROR;
+
+  char path[4096];
+  if (ctx->params.workshops == 1)
+  {
+    snprintf(path, sizeof(path), "%s", ctx->params.sinkTarget);
+  }
+  else
+  {
+    const char *dot = strrchr(ctx->params.sinkTarget, '.');
+    const char *slash = strrchr(ctx->params.sinkTarget, '/');
+    if (dot == NULL || (slash != NULL && dot < slash))
+      dot = ctx->params.sinkTarget + strlen(ctx->params.sinkTarget);
+
+    snprintf(path, sizeof(path), "%.*s.%zu%s", (int)(dot - ctx->params.sinkTarget), ctx->params.sinkTarget, index + 1, dot);
+  }
+
+  if ((ctx->outputSink.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1)
+    return OF_OPEN_ERROR;
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Close part of sink private to current workshop
+ */
+void closeWorkshopSink()
+{
+  if (ctx->params.sinkType == SINK_FILE && ctx->outputSink.fd != -1)
+  {
+    close(ctx->outputSink.fd);
+    ctx->outputSink.fd = -1;
+  }
+}
+
+/**
+ * @brief Check if sink is shared by all workshops and lines have to be tagged by workshop
+ */
+bool isSinkShared()
+{
+  return ctx->params.workshops > 1 && ctx->params.sinkType != SINK_FILE;
+}
+
+/**
+ * @brief Write formatted @p line to sink
+ *
+ * Caller holds output lock of its workshop
+ *
+ * @param line formatted line
+ * @param len length of line
+ */
+void sinkWrite(const char *line, size_t len)
+{
+  if (ctx->outputSink.memory != NULL)
+  {
+    // Space is reserved atomically because workshops don't share output lock
+    MemorySink *mem = ctx->outputSink.memory;
+    size_t offset = __atomic_fetch_add(&mem->used, len, __ATOMIC_RELAXED);
+
+    if (offset + len <= mem->capacity)
+      memcpy(mem->data + offset, line, len);
+    else
+      __atomic_add_fetch(&mem->dropped, len, __ATOMIC_RELAXED);
+
+    return;
+  }
+
+  while (ctx->outputSink.fd != -1 && len > 0)
+  {
+    ssize_t written = write(ctx->outputSink.fd, line, len);
+    if (written < 0)
+    {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    line += written;
+    len -= written;
+  }
+}
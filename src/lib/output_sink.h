@@ -0,0 +1,28 @@
+/**
+ * @file output_sink.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for pluggable output sinks
+ */
+
+#ifndef IOS_PROJECT2_OUTPUT_SINK_H
+#define IOS_PROJECT2_OUTPUT_SINK_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+
+#define SINK_DEFAULT_PATH "proj2.out"
+#define SINK_DEFAULT_MEMORY_SIZE (64 * 1024 * 1024)
+
+ReturnCode parseSinkSpec(const char *spec, Params *prm);
+ReturnCode openSink();
+void closeSink(ReturnCode *retVal);
+ReturnCode openWorkshopSink(size_t index);
+void closeWorkshopSink();
+bool isSinkShared();
+void sinkWrite(const char *line, size_t len);
+
+#endif //IOS_PROJECT2_OUTPUT_SINK_H
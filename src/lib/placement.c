@@ -0,0 +1,184 @@
+/**
+ * @file placement.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief CPU affinity and scheduling class of processes applied right after fork
+ *
+ * Failures (missing CPU, missing permission for SCHED_FIFO) don't stop simulation,
+ * they are counted in shared memory and shown in report.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "placement.h"
+
+static cpu_set_t inheritedSet;                  /**< Affinity before pinning logging process */
+static bool loggerPinned = false;               /**< Logging process was pinned, children have to restore affinity */
+
+/**
+ * @brief Restore affinity inherited from before pinning of logging process
+ */
+static void restoreAffinity()
+{
+  if (loggerPinned)
+    sched_setaffinity(0, sizeof(inheritedSet), &inheritedSet);
+}
+
+/**
+ * @brief Parse list of CPUs in format "0-3,6"
+ *
+ * @param list list to parse
+ * @param mask output bit mask of CPUs with CPU_MASK_WORDS words
+ * @param count output number of CPUs in list
+ * @return ReturnCode with NO_ERROR if it was successful or INVALID_ARGUMENT_ERROR
+ */
+ReturnCode parseCpuList(const char *list, uint64_t *mask, int *count)
+{
+  char *rest = NULL;
+
+  memset(mask, 0, sizeof(uint64_t) * CPU_MASK_WORDS);
+  *count = 0;
+
+  while (*list != 0)
+  {
+    long first = strtol(list, &rest, 10);
+    long last = first;
+    if (rest == list) return INVALID_ARGUMENT_ERROR;
+
+    if (*rest == '-')
+    {
+      list = rest + 1;
+      last = strtol(list, &rest, 10);
+      if (rest == list) return INVALID_ARGUMENT_ERROR;
+    }
+
+    if (first < 0 || last < first || last >= CPU_MASK_WORDS * 64) return INVALID_ARGUMENT_ERROR;
+
+    for (long cpu = first; cpu <= last; cpu++)
+    {
+      if (!(mask[cpu / 64] & (1ULL << (cpu % 64))))
+        (*count)++;
+      mask[cpu / 64] |= 1ULL << (cpu % 64);
+    }
+
+    if (*rest == ',')
+      rest++;
+    else if (*rest != 0)
+      return INVALID_ARGUMENT_ERROR;
+
+    list = rest;
+  }
+
+  return *count > 0 ? NO_ERROR : INVALID_ARGUMENT_ERROR;
+}
+
+/**
+ * @brief Get elf placement pattern from its name (roundrobin, block)
+ */
+ReturnCode parseElfPlacement(const char *name, ElfPlacement *placement)
+{
+  if (strcmp(name, "roundrobin") == 0)
+    *placement = PLACEMENT_ROUND_ROBIN;
+  else if (strcmp(name, "block") == 0)
+    *placement = PLACEMENT_BLOCK;
+  else
+    return INVALID_ARGUMENT_ERROR;
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Pin calling process to @p cpu, failure is counted in shared memory
+ */
+static void pinToCpu(int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  if (sched_setaffinity(0, sizeof(set), &set) == -1 && ctx->sharedMemory != NULL)
+    __atomic_add_fetch(&ctx->sharedMemory->placementFailures, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Apply placement of Santa to calling process
+ */
+void placeSanta()
+{
+  if (ctx->params.santaCpu >= 0)
+    pinToCpu(ctx->params.santaCpu);
+  else
+    restoreAffinity();
+
+  if (ctx->params.santaFifoPriority > 0)
+  {
+    struct sched_param sp = { .sched_priority = ctx->params.santaFifoPriority };
+    ctx->sharedMemory->santaFifo = (sched_setscheduler(0, SCHED_FIFO, &sp) == 0);
+    if (!ctx->sharedMemory->santaFifo)
+      __atomic_add_fetch(&ctx->sharedMemory->placementFailures, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+ * @brief Apply placement of elf with @p id to calling process
+ *
+ * Elves are spread over CPU set either round robin or in contiguous blocks
+ */
+void placeElf(size_t id)
+{
+  if (ctx->params.elfCpuCount == 0)
+  {
+    restoreAffinity();
+    return;
+  }
+
+  size_t index;
+  if (ctx->params.elfPlacement == PLACEMENT_BLOCK)
+  {
+    size_t perCpu = (ctx->params.ne + ctx->params.elfCpuCount - 1) / ctx->params.elfCpuCount;
+    index = ((id - 1) / perCpu) % ctx->params.elfCpuCount;
+  }
+  else
+    index = (id - 1) % ctx->params.elfCpuCount;
+
+  // Find index-th CPU in mask
+  for (int cpu = 0; cpu < CPU_MASK_WORDS * 64; cpu++)
+  {
+    if (!(ctx->params.elfCpus[cpu / 64] & (1ULL << (cpu % 64)))) continue;
+
+    if (index == 0)
+    {
+      pinToCpu(cpu);
+      return;
+    }
+    index--;
+  }
+}
+
+/**
+ * @brief Apply placement of reindeer to calling process
+ *
+ * Reindeers have no CPU set of their own, they only drop pinning of logging process
+ */
+void placeReindeer()
+{
+  restoreAffinity();
+}
+
+/**
+ * @brief Apply placement of logging process (main process or consumer of pipe sink)
+ *
+ * Has to be called after creating workshop processes, processes created later restore inherited affinity
+ */
+void placeLogger()
+{
+  if (ctx->params.logCpu < 0 || loggerPinned) return;
+
+  if (sched_getaffinity(0, sizeof(inheritedSet), &inheritedSet) == 0)
+    loggerPinned = true;
+
+  pinToCpu(ctx->params.logCpu);
+}
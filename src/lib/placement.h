@@ -0,0 +1,23 @@
+/**
+ * @file placement.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for CPU placement of processes
+ */
+
+#ifndef IOS_PROJECT2_PLACEMENT_H
+#define IOS_PROJECT2_PLACEMENT_H
+
+#include <stdbool.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+
+ReturnCode parseCpuList(const char *list, uint64_t *mask, int *count);
+ReturnCode parseElfPlacement(const char *name, ElfPlacement *placement);
+void placeSanta();
+void placeElf(size_t id);
+void placeReindeer();
+void placeLogger();
+
+#endif //IOS_PROJECT2_PLACEMENT_H
@@ -0,0 +1,160 @@
+/**
+ * @file planner.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Search of maximal elf load meeting wait-time SLO
+ *
+ * Every measured load is full run of workshop with real Santa and elf processes, p99 is taken
+ * from histogram of time between "need help" and "get help". Elves still queued when workshop
+ * closes add their wait until closing, so overloaded workshop can't look fast by sending its
+ * longest waits home. Length of trial is set by --duration or --seasons. Small loads can miss SLO too,
+ * because elves wait for group to fill, so load is doubled until it first meets SLO and then
+ * until it misses it or NE is reached. Then it is bisected between last passing and first
+ * failing load.
+ */
+
+#include "planner.h"
+
+/**
+ * @struct plan_point
+ * @brief Result of run with one number of elves
+ */
+typedef struct plan_point
+{
+  int ne;                         /**< Number of elves */
+  double runtime;                 /**< Length of run in seconds */
+  int64_t helps;                  /**< Number of helps */
+  int64_t unserved;               /**< Number of elves sent home from queue at closing */
+  int64_t p50;                    /**< Median wait for help in nanoseconds */
+  int64_t p99;                    /**< 99th percentile of wait for help in nanoseconds */
+  int64_t events;                 /**< Number of events */
+  int64_t groups;                 /**< Number of served groups */
+  bool pass;                      /**< Run met SLO */
+} PlanPoint;
+
+/**
+ * @brief Run workshop with @p ne elves and measure it
+ */
+static ReturnCode runTrial(int ne, PlanPoint *point)
+{
+  ctx->params.ne = ne;
+
+  ReturnCode retVal = allocateResources();
+  if (retVal == NO_ERROR)
+    retVal = runWorkshop(0, NULL, NULL);
+
+  if (retVal == NO_ERROR)
+  {
+    LatencyHistogram *wait = (LatencyHistogram *)&ctx->sharedMemory->waitLatency;
+
+    point->ne = ne;
+    point->runtime = (double)(monotonicTime() - ctx->sharedMemory->startTime) / NSEC_PER_SEC;
+    point->unserved = ctx->sharedMemory->elvesUnserved;
+    point->helps = wait->count - point->unserved;
+    point->p50 = histogramPercentile(wait, 50.0);
+    point->p99 = histogramPercentile(wait, 99.0);
+    point->events = ctx->sharedMemory->actionId - 1;
+    point->groups = ctx->sharedMemory->groupsServed;
+
+    // Run without any help says nothing about latency
+    point->pass = point->helps > 0 && point->p99 <= (int64_t)(ctx->params.sloP99 * NSEC_PER_SEC / 1000);
+  }
+
+  retVal |= deallocateResources();
+  return retVal;
+}
+
+/**
+ * @brief Order measured points by number of elves
+ */
+static int comparePoints(const void *a, const void *b)
+{
+  return ((const PlanPoint *)a)->ne - ((const PlanPoint *)b)->ne;
+}
+
+/**
+ * @brief Print measured throughput/latency curve and result of search
+ */
+static void printPlan(PlanPoint *points, size_t count, int best)
+{
+  qsort(points, count, sizeof(PlanPoint), comparePoints);
+
+  char trial[64];
+  if (ctx->params.duration > 0.0)
+    snprintf(trial, sizeof(trial), "%g s", ctx->params.duration);
+  else
+    snprintf(trial, sizeof(trial), "%d season%s", ctx->params.seasons, ctx->params.seasons == 1 ? "" : "s");
+
+  fprintf(stderr, "Plan (p99 SLO %.3f ms, policy %s, handoff %s, trial %s):\n", ctx->params.sloP99,
+          policyName(ctx->params.policy), handoffName(ctx->params.handoff), trial);
+  fprintf(stderr, "  %6s %9s %8s %8s %10s %10s %12s %12s\n", "ne", "runtime", "helps", "unserved",
+          "p50 ms", "p99 ms", "events/s", "groups/s");
+
+  for (size_t i = 0; i < count; i++)
+  {
+    PlanPoint *p = &points[i];
+    fprintf(stderr, "  %6d %8.3fs %8lld %8lld %10.3f %10.3f %12.1f %12.1f %s\n", p->ne, p->runtime,
+            (long long)p->helps, (long long)p->unserved, (double)p->p50 / 1000000.0, (double)p->p99 / 1000000.0,
+
+            p->runtime > 0 ? p->events / p->runtime : 0.0, p->runtime > 0 ? p->groups / p->runtime : 0.0,
+            p->pass ? "ok" : "miss");
+  }
+
+  if (best > 0)
+    fprintf(stderr, "Max sustainable elves: %d\n", best);
+  else
+    fprintf(stderr, "Max sustainable elves: none, SLO is missed by all measured loads\n");
+}
+
+/**
+ * @brief Find largest number of elves up to NE for which p99 of wait for help meets SLO
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode runPlan()
+{
+  PlanPoint points[PLAN_MAX_POINTS];
+  size_t count = 0;
+  int maxElves = ctx->params.ne;
+  int pass = 0, miss = maxElves + 1;
+
+  // Grow load until SLO is met and missed again
+  for (int ne = PLAN_MIN_ELVES < maxElves ? PLAN_MIN_ELVES : maxElves; count < PLAN_MAX_POINTS; )
+  {
+    ReturnCode retVal = runTrial(ne, &points[count]);
+    if (retVal != NO_ERROR)
+      return retVal;
+
+    if (points[count++].pass)
+      pass = ne;
+    else if (pass > 0)
+    {
+      miss = ne;
+      break;
+    }
+
+    if (ne == maxElves)
+      break;
+    ne = (ne * 2 < maxElves) ? ne * 2 : maxElves;
+  }
+
+  // Bisect between last passing and first failing load
+  while (pass > 0 && miss - pass > 1 && count < PLAN_MAX_POINTS)
+  {
+    int ne = pass + (miss - pass) / 2;
+
+    ReturnCode retVal = runTrial(ne, &points[count]);
+    if (retVal != NO_ERROR)
+      return retVal;
+
+    if (points[count++].pass)
+      pass = ne;
+    else
+      miss = ne;
+  }
+
+  ctx->params.ne = maxElves;
+  printPlan(points, count, pass);
+
+  return NO_ERROR;
+}
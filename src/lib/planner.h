@@ -0,0 +1,28 @@
+/**
+ * @file planner.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for search of maximal elf load meeting wait-time SLO
+ */
+
+#ifndef IOS_PROJECT2_PLANNER_H
+#define IOS_PROJECT2_PLANNER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "resource_allocation.h"
+#include "workshop.h"
+#include "latency.h"
+#include "timing.h"
+#include "admission.h"
+#include "handoff.h"
+
+#define PLAN_MIN_ELVES 3        /**< Smallest load where elves can form group */
+#define PLAN_MAX_POINTS 64      /**< Max number of measured loads */
+
+ReturnCode runPlan();
+
+#endif //IOS_PROJECT2_PLANNER_H
@@ -0,0 +1,69 @@
+/**
+ * @file probes.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Statically defined tracepoints of provider proj2
+ *
+ * Probes are compiled to single nop when sys/sdt.h is available, otherwise they are left out.
+ * All probes get role and id of entity and current action id, for example:
+ *
+ *   bpftrace -e 'usdt:./proj2:proj2:elf__get__help { @[arg1] = count(); }'
+ */
+
+#ifndef IOS_PROJECT2_PROBES_H
+#define IOS_PROJECT2_PROBES_H
+
+#include <semaphore.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+
+#define PROBE_ROLE_MAIN 0       /**< Main process or workshop runner */
+#define PROBE_ROLE_SANTA 1      /**< Santa */
+#define PROBE_ROLE_ELF 2        /**< Elf */
+#define PROBE_ROLE_RD 3         /**< Reindeer */
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>) && !defined(NO_PROBES)
+#include <sys/sdt.h>
+#define PROBES_ENABLED
+#endif
+#endif
+
+#ifdef PROBES_ENABLED
+#define PROBE(name) \
+  DTRACE_PROBE3(proj2, name, ctx->probeRole, ctx->probeId, (long long)ctx->sharedMemory->actionId)
+#define PROBE_SEM(name, sem) \
+  DTRACE_PROBE4(proj2, name, ctx->probeRole, ctx->probeId, (long long)ctx->sharedMemory->actionId, SEM_INDEX(sem))
+#else
+#define PROBE(name) ((void)0)
+#define PROBE_SEM(name, sem) ((void)0)
+#endif
+
+/**
+ * @brief Index of semaphore in SemHolder passed to semaphore probes
+ */
+#define SEM_INDEX(sem) ((int)((sem_t *)(sem) - (sem_t *)ctx->semHolder))
+
+/**
+ * @brief Wait on semaphore of SemHolder between sem__wait__entry and sem__wait__exit probes
+ */
+#define SEM_WAIT(sem) \
+  do \
+  { \
+    PROBE_SEM(sem__wait__entry, sem); \
+    sem_wait(sem); \
+    PROBE_SEM(sem__wait__exit, sem); \
+  } while (0)
+
+/**
+ * @brief Set role and id of entity running in this process
+ */
+#define PROBE_IDENTITY(role, id) \
+  do \
+  { \
+    ctx->probeRole = (role); \
+    ctx->probeId = (int)(id); \
+  } while (0)
+
+#endif //IOS_PROJECT2_PROBES_H
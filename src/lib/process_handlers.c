@@ -17,24 +17,26 @@ void addElves()
   signal(SIGQUIT, SIG_IGN);
   signal(SIGUSR1, SIG_IGN);
 
-  // Generate new size of elf process ids array
-  size_t oldElvesCount = processHolder.elvesCount;
-  size_t newElvesCount = oldElvesCount + (random() % params.ne) + 1;
+  // Generate new size of elf process ids array, limited by number of elf slots
+  size_t oldElvesCount = ctx->processHolder.elvesCount;
+  size_t newElvesCount = oldElvesCount + (random() % ctx->params.ne) + 1;
+  if (newElvesCount > ctx->sharedMemory->elfCapacity)
+    newElvesCount = ctx->sharedMemory->elfCapacity;
 
   // printf("Adding %ld new elves\n", newElvesCount - oldElvesCount);
 
   // Reallocate elf process ids array
-  pid_t *tmp = (pid_t*)realloc(processHolder.elfIds, newElvesCount * sizeof(pid_t));
+  pid_t *tmp = (pid_t*)realloc(ctx->processHolder.elfIds, newElvesCount * sizeof(pid_t));
   if (tmp == NULL)
     handleErrors(PID_ALLOCATION_ERROR);
 
   // Replace pointer
-  processHolder.elfIds = tmp;
-  processHolder.elvesCount = newElvesCount;
+  ctx->processHolder.elfIds = tmp;
+  ctx->processHolder.elvesCount = newElvesCount;
 
   signal(SIGQUIT, terminate);
   
-  sharedMemory->numberOfElves = processHolder.elvesCount;
+  ctx->sharedMemory->numberOfElves = ctx->processHolder.elvesCount;
 
   // Generate new elves
   for (size_t i = oldElvesCount; i < newElvesCount; i++)
@@ -47,11 +49,12 @@ void addElves()
     }
     else if (tmp_proc == 0)
     {
+      placeElf(i + 1);
       handle_elf(i + 1);
-      exit(0);
+      _exit(0);
     }
     else
-      processHolder.elfIds[i] = tmp_proc;
+      ctx->processHolder.elfIds[i] = tmp_proc;
   }
 
   signal(SIGUSR1, addElves);
@@ -69,62 +72,83 @@ void handle_elf(size_t id)
   // Init random generator
   srand(time(NULL) * getpid());
 
-  printToOutput("Elf", id, "started");
+  PROBE_IDENTITY(PROBE_ROLE_ELF, id);
+  EMIT(EVENT_ELF_STARTED, "Elf", id, "started");
+  traceEntity("Elf", id);
+
+  ElfState state = ELF_WORKING;
+  STAT_ADD(elves[ELF_WORKING], 1);
+
+  ElfSlot *slot = elfSlot(id);
+  int64_t unservedSince = 0;
 
   while (true)
   {
     // Work for random amount of time
-    unsigned int work_time = (random() % (params.te + 1));
-    usleep(work_time * 1000);
+    traceState("working");
+    sleepFor(randomDuration(0, ctx->params.te));
 
-    printToOutput("Elf", id, "need help");
+    EMIT(EVENT_ELF_NEED_HELP, "Elf", id, "need help");
+    PROBE(elf__need__help);
+    changeElfState(&state, ELF_QUEUED);
+    traceState("queued");
+    int64_t needHelpTime = monotonicTime();
+    if (slot != NULL)
+      slot->queuedSince = needHelpTime;
 
     // If shop is closed go elf dont need help and can take holidays
-    if (sharedMemory->shopClosed) break;
+    if (ctx->sharedMemory->shopClosed) break;
 
     // Wait in queue for empty workshop
-    sem_wait(&semHolder->waitInQueue);
-
-    if (sharedMemory->shopClosed) break;
+    admitElf(id);
+    PROBE(elf__admitted);
 
-    // Wake Santa if third in queue
-    sem_wait(&semHolder->elfQueueMutex);
-    sharedMemory->elfReadyQueue++;
-
-    if (sharedMemory->elfReadyQueue >= 3)
+    if (ctx->sharedMemory->shopClosed)
     {
-      sem_post(&semHolder->wakeForHelp);
+      unservedSince = needHelpTime;
+      break;
     }
-    sem_post(&semHolder->elfQueueMutex);
-
-    // Wait for help
-    sem_wait(&semHolder->waitForHelp);
 
-    sem_wait(&semHolder->elfQueueMutex);
-    sharedMemory->elfReadyQueue--;
-    sem_post(&semHolder->elfQueueMutex);
+    // Wake Santa if third in queue and wait for help
+    joinGroup();
+    changeElfState(&state, ELF_HELPED);
+    traceState("helped");
 
-    if (sharedMemory->shopClosed) break;
-
-    printToOutput("Elf", id, "get help");
+    if (ctx->sharedMemory->shopClosed)
+    {
+      unservedSince = needHelpTime;
+      break;
+    }
 
-    // Get help from Santa
-    sem_post(&semHolder->elfHelped);
+    EMIT(EVENT_ELF_GET_HELP, "Elf", id, "get help");
+    PROBE(elf__get__help);
 
-    // Signal to 3 next elves that workshop is free
-    sem_wait(&semHolder->elfQueueMutex);
-    if (sharedMemory->elfReadyQueue == 0)
+    int64_t waited = monotonicTime() - needHelpTime;
+    histogramAdd((LatencyHistogram *)&ctx->sharedMemory->waitLatency, waited);
+    if (slot != NULL)
     {
-      sem_post(&semHolder->waitInQueue);
-      sem_post(&semHolder->waitInQueue);
-      sem_post(&semHolder->waitInQueue);
+      slot->helps++;
+      slot->waitedTotal += waited;
     }
-    sem_post(&semHolder->elfQueueMutex);
+
+    // Get help from Santa and free workshop for next elves
+    leaveGroup();
+    changeElfState(&state, ELF_WORKING);
+  }
+
+  // Elf sent home from queue waited until closing, without it overloaded workshop would look fast
+  if (unservedSince != 0)
+  {
+    histogramAdd((LatencyHistogram *)&ctx->sharedMemory->waitLatency, monotonicTime() - unservedSince);
+    __atomic_add_fetch(&ctx->sharedMemory->elvesUnserved, 1, __ATOMIC_RELAXED);
   }
 
   // take holidays
-  printToOutput("Elf", id, "taking holidays");
-  sem_post(&semHolder->childFinished);
+  changeElfState(&state, ELF_HOLIDAYS);
+
+  EMIT(EVENT_ELF_HOLIDAYS, "Elf", id, "taking holidays");
+  traceState(NULL);
+  sem_post(&ctx->semHolder->childFinished);
 
   // printf("Elf %ld finished\n", id);
 }
@@ -132,7 +156,8 @@ void handle_elf(size_t id)
 /**
  * @brief Handler for reindeer processes
  *
- * Wait for all reindeers to return and wakeup Santa
+ * Wait for all reindeers to return and wakeup Santa, after hitching go on vacation
+ * again until last season ends
  *
  * @param id id of reindeer
  */
@@ -141,86 +166,159 @@ void handle_rd(size_t id)
   // Init random generator
   srand(time(NULL) * getpid());
 
-  printToOutput("RD", id, "rstarted");
+  PROBE_IDENTITY(PROBE_ROLE_RD, id);
+  EMIT(EVENT_RD_STARTED, "RD", id, "rstarted");
+  traceEntity("RD", id);
 
-  // Wait some time before going home
-  unsigned int vac_time = (random() % ((params.tr - params.tr / 2) + 1)) + params.tr / 2;
-  usleep(vac_time * 1000);
+  while (true)
+  {
+    // Wait some time before going home
+    traceState("vacation");
+    sleepFor(randomDuration(ctx->params.tr / 2, ctx->params.tr));
 
-  sem_wait(&semHolder->rdReadyCountMutex);
-  sharedMemory->readyRDCount++;
+    SEM_WAIT(&ctx->semHolder->rdReadyCountMutex);
+    ctx->sharedMemory->readyRDCount++;
+    STAT_ADD(rdReturned, 1);
 
-  if (sharedMemory->readyRDCount == params.nr)
-  {
-    // Wake santa if last
-    sem_wait(&semHolder->santaReady);
-    printToOutput("RD", id, "return home");
-    kill(processHolder.santaId, SIGUSR2);
-    sem_post(&semHolder->santaReady);
-  }
-  else
-    printToOutput("RD", id, "return home");
-  
-  sem_post(&semHolder->rdReadyCountMutex);
+    if (ctx->sharedMemory->readyRDCount == ctx->params.nr)
+    {
+      // Wake santa if last
+      SEM_WAIT(&ctx->semHolder->santaReady);
+      EMIT(EVENT_RD_RETURN, "RD", id, "return home");
+      PROBE(rd__return);
+      ctx->sharedMemory->reindeersBack = true;
+      ctx->sharedMemory->wakeRequested = monotonicTime();
+      sem_post(&ctx->semHolder->wakeForHelp);
+      sem_post(&ctx->semHolder->santaReady);
+    }
+    else
+    {
+      EMIT(EVENT_RD_RETURN, "RD", id, "return home");
+      PROBE(rd__return);
+    }
+
+    traceState("waiting");
+    sem_post(&ctx->semHolder->rdReadyCountMutex);
 
-  // Wait for hitch
-  sem_wait(&semHolder->rdWaitForHitch);
+    // Wait for hitch
+    SEM_WAIT(&ctx->semHolder->rdWaitForHitch);
 
-  printToOutput("RD", id, "get hitched");
+    EMIT(EVENT_RD_HITCHED, "RD", id, "get hitched");
+    PROBE(rd__hitch);
+    traceState("hitched");
 
-  // Signalize was hitched
-  sem_post(&semHolder->rdHitched);
-  sem_post(&semHolder->childFinished);
+    // Signalize was hitched
+    sem_post(&ctx->semHolder->rdHitched);
+
+    if (ctx->sharedMemory->shopClosed) break;
+
+    // Wait until Santa opens next season
+    SEM_WAIT(&ctx->semHolder->rdVacation);
+  }
+
+  traceState(NULL);
+  sem_post(&ctx->semHolder->childFinished);
 
   // printf("RD %ld finished\n", id);
 }
 
 /**
- * @brief Handle leaving of Santa
+ * @brief Check if season ending by Christmas is the last one
+ */
+static bool lastSeason()
+{
+  if (ctx->params.seasons > 0 && ctx->sharedMemory->seasons + 1 >= ctx->params.seasons)
+    return true;
+
+  return ctx->params.duration > 0.0 &&
+         monotonicTime() - ctx->sharedMemory->startTime >= (int64_t)(ctx->params.duration * NSEC_PER_SEC);
+}
+
+/**
+ * @brief Record end of season and print its throughput when report was requested
  */
-void handle_santa_end()
+static void finishSeason()
 {
-  printToOutput("Santa", NO_ID, "closing workshop");
-  sharedMemory->shopClosed = true;
+  SeasonMark mark = { monotonicTime(), ctx->sharedMemory->actionId - 1, ctx->sharedMemory->groupsServed };
 
-  for (int i = 0; i < params.nr; i++)
+  if (ctx->sharedMemory->seasons == 0)
+    ctx->sharedMemory->firstChristmas = mark;
+
+  ctx->sharedMemory->seasons++;
+  STAT_ADD(rdReturned, -ctx->params.nr);
+  STAT_ADD(seasons, 1);
+  if (ctx->params.report && (ctx->params.seasons != 1 || ctx->params.duration > 0.0))
+    printSeasonReport(ctx->sharedMemory->seasons, (SeasonMark *)&ctx->sharedMemory->seasonStart, &mark);
+
+  ctx->sharedMemory->seasonStart = mark;
+}
+
+/**
+ * @brief Handle Christmas, after last season Santa leaves and workshop is closed
+ *
+ * Otherwise reindeers go on vacation again and workshop stays open, so workshop
+ * is announced as closing only in last season
+ */
+static void handle_christmas()
+{
+  bool last = lastSeason();
+
+  ctx->sharedMemory->reindeersBack = false;
+  if (last)
+    EMIT(EVENT_SANTA_CLOSING, "Santa", NO_ID, "closing workshop");
+  else
+    EMIT(EVENT_SANTA_HITCHING, "Santa", NO_ID, "hitching reindeers");
+  traceState("hitching");
+  if (last)
+  {
+    PROBE(shutdown__start);
+    ctx->sharedMemory->shopClosed = true;
+  }
+
+  for (int i = 0; i < ctx->params.nr; i++)
   {
     // Hitch all RDs
-    sem_post(&semHolder->rdWaitForHitch);
-    sem_wait(&semHolder->rdHitched);
+    sem_post(&ctx->semHolder->rdWaitForHitch);
+    SEM_WAIT(&ctx->semHolder->rdHitched);
   }
 
-  printToOutput("Santa", NO_ID, "Christmas started");
-  sem_post(&semHolder->christmasStarted);
+  if (last)
+    EMIT(EVENT_SANTA_CHRISTMAS, "Santa", NO_ID, "Christmas started");
+  else
+    EMIT(EVENT_SANTA_CHRISTMAS, "Santa", NO_ID, "Christmas started, workshop stays open");
+  finishSeason();
 
-  // Send home elves
-  sem_wait(&semHolder->numOfElvesStable);
-  for (size_t i = 0; i < sharedMemory->numberOfElves; i++)
+
+  if (!last)
   {
-    sem_post(&semHolder->waitInQueue);
-    sem_post(&semHolder->waitForHelp);
+    // All reindeers are hitched, so no one can return before reset
+    SEM_WAIT(&ctx->semHolder->rdReadyCountMutex);
+    ctx->sharedMemory->readyRDCount = 0;
+    sem_post(&ctx->semHolder->rdReadyCountMutex);
+
+    for (int i = 0; i < ctx->params.nr; i++)
+      sem_post(&ctx->semHolder->rdVacation);
+
+    return;
   }
-  sem_post(&semHolder->numOfElvesStable);
 
-  sem_post(&semHolder->childFinished);
+  sem_post(&ctx->semHolder->christmasStarted);
 
-  // printf("Santa finished\n");
+  // Send home elves
+  SEM_WAIT(&ctx->semHolder->numOfElvesStable);
+  for (size_t i = 0; i < ctx->sharedMemory->numberOfElves; i++)
+    sem_post(&ctx->semHolder->waitInQueue);
+  closeGroups(ctx->sharedMemory->numberOfElves);
+  sem_post(&ctx->semHolder->numOfElvesStable);
+  releaseAllElves();
 
-  exit(0);
-}
+  traceState(NULL);
+  PROBE(shutdown__end);
+  sem_post(&ctx->semHolder->childFinished);
 
-/**
- * @brief Help elves
- * 
- * @param number number of elves to help
- */
-void help_elves(size_t number)
-{
-  for(size_t i = 0; i < number; i++)
-    sem_post(&semHolder->waitForHelp);
+  // printf("Santa finished\n");
 
-  for(size_t i = 0; i < number; i++)
-    sem_wait(&semHolder->elfHelped);
+  _exit(0);
 }
 
 /**
@@ -230,23 +328,49 @@ void help_elves(size_t number)
  */
 void handle_santa()
 {
-  signal(SIGUSR2, handle_santa_end);
+  ctx->sharedMemory->seasonStart.time = ctx->sharedMemory->startTime;
 
-  printToOutput("Santa", NO_ID, "going to sleep");
-  sem_post(&semHolder->santaReady);
+  PROBE_IDENTITY(PROBE_ROLE_SANTA, NO_ID);
+  EMIT(EVENT_SANTA_SLEEP, "Santa", NO_ID, "going to sleep");
+  PROBE(santa__sleep);
+  traceEntity("Santa", NO_ID);
+  traceState("sleeping");
+  sem_post(&ctx->semHolder->santaReady);
 
   while (true)
   {
-    // Santa will get woken up and will go help elfs
-    sem_wait(&semHolder->wakeForHelp);
+    // Santa will get woken up by elves or reindeers
+    ctx->sharedMemory->santaSleepStart = monotonicTime();
+    handoffWait(&ctx->semHolder->wakeForHelp);
 
-    sem_wait(&semHolder->santaReady);
-    printToOutput("Santa", NO_ID, "helping elves");
 
-    help_elves(3);
+    // Wake-up requested while Santa was busy didn't block him, it isn't wake-up latency
+    if (ctx->sharedMemory->wakeRequested >= ctx->sharedMemory->santaSleepStart)
+      histogramAdd((LatencyHistogram *)&ctx->sharedMemory->santaWakeLatency, monotonicTime() - ctx->sharedMemory->wakeRequested);
+    PROBE(santa__wake);
+
+    SEM_WAIT(&ctx->semHolder->santaReady);
+
+    // Reindeers have priority, unused wake-up stays for waiting elves
+    if (ctx->sharedMemory->reindeersBack)
+    {
+      handle_christmas();
+    }
+    else
+    {
+      EMIT(EVENT_SANTA_HELP, "Santa", NO_ID, "helping elves");
+      traceState("helping");
+      PROBE(santa__help__start);
+
+      serveGroup();
+      PROBE(santa__help__end);
+      STAT_ADD(groupsServed, 1);
+    }
 
-    printToOutput("Santa", NO_ID, "going to sleep");
+    EMIT(EVENT_SANTA_SLEEP, "Santa", NO_ID, "going to sleep");
+    PROBE(santa__sleep);
+    traceState("sleeping");
 
-    sem_post(&semHolder->santaReady);
+    sem_post(&ctx->semHolder->santaReady);
   }
 }
@@ -19,6 +19,16 @@
 #include "shared_resources.h"
 #include "error_handling.h"
 #include "utils.h"
+#include "events.h"
+#include "admission.h"
+#include "handoff.h"
+#include "latency.h"
+#include "placement.h"
+#include "statistics.h"
+#include "timing.h"
+#include "report.h"
+#include "trace.h"
+#include "probes.h"
 
 void addElves();
 void handle_elf(size_t id);
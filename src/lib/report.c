@@ -0,0 +1,257 @@
+/**
+ * @file report.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Summary report of simulation printed after all processes finished
+ */
+
+#include "report.h"
+
+#include <sys/resource.h>
+
+/**
+ * @brief Print report about timing precision
+ */
+static void printTimingReport()
+{
+  TimingStats total = { 0 };
+  for (int i = 0; i < ctx->params.workshops; i++)
+  {
+    TimingStats *ws = &ctx->workshops[i].sharedMemory.timing;
+    total.sleepCount += ws->sleepCount;
+    total.requestedTotal += ws->requestedTotal;
+    total.overshootTotal += ws->overshootTotal;
+    if (ws->overshootMax > total.overshootMax)
+      total.overshootMax = ws->overshootMax;
+  }
+
+  TimingStats *stats = &total;
+
+  if (stats->sleepCount == 0)
+  {
+    fprintf(stderr, "  sleeps:       none\n");
+    return;
+  }
+
+  double requestedAvg = (double)stats->requestedTotal / stats->sleepCount / NSEC_PER_USEC;
+  double overshootAvg = (double)stats->overshootTotal / stats->sleepCount / NSEC_PER_USEC;
+  double overshootPct = stats->requestedTotal > 0 ? (double)stats->overshootTotal * 100.0 / stats->requestedTotal : 0.0;
+
+  fprintf(stderr, "  sleeps:       %lld (time scale %g)\n", (long long)stats->sleepCount, ctx->params.timeScale);
+  fprintf(stderr, "  requested:    avg %.1f us\n", requestedAvg);
+  fprintf(stderr, "  overshoot:    avg %.1f us, max %.1f us, %.2f %% of requested time\n",
+          overshootAvg, (double)stats->overshootMax / NSEC_PER_USEC, overshootPct);
+}
+
+/**
+ * @brief Print report about admission fairness and waiting for help
+ */
+static void printFairnessReport()
+{
+  double sum = 0.0, sumSq = 0.0;
+  int64_t minHelps = -1, maxHelps = 0;
+  size_t elves = 0;
+  int64_t unserved = 0;
+
+  LatencyHistogram *wait = calloc(1, sizeof(LatencyHistogram));
+  if (wait == NULL) return;
+
+  for (int w = 0; w < ctx->params.workshops; w++)
+  {
+    SharedMemory *mem = &ctx->workshops[w].sharedMemory;
+    histogramMerge(wait, &mem->waitLatency);
+    unserved += mem->elvesUnserved;
+
+
+    size_t count = mem->numberOfElves < mem->elfCapacity ? mem->numberOfElves : mem->elfCapacity;
+    for (size_t i = 0; i < count; i++)
+    {
+      int64_t helps = ctx->workshops[w].elfSlots[i].helps;
+      sum += helps;
+      sumSq += (double)helps * helps;
+      if (minHelps < 0 || helps < minHelps) minHelps = helps;
+      if (helps > maxHelps) maxHelps = helps;
+      elves++;
+    }
+  }
+
+  // Jain's fairness index, 1.0 means all elves got same number of helps
+  double jain = (sumSq > 0.0) ? (sum * sum) / (elves * sumSq) : 1.0;
+
+  fprintf(stderr, "  policy:       %s\n", policyName(ctx->params.policy));
+  fprintf(stderr, "  helps/elf:    min %lld, max %lld, avg %.2f, Jain's index %.4f\n",
+          (long long)(minHelps < 0 ? 0 : minHelps), (long long)maxHelps, elves ? sum / elves : 0.0, jain);
+
+  if (wait->count > 0)
+  {
+    fprintf(stderr, "  help wait:    avg %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us (%lld helps, %lld sent home unserved)\n",
+            (double)wait->total / wait->count / NSEC_PER_USEC,
+            (double)histogramPercentile(wait, 50.0) / NSEC_PER_USEC,
+            (double)histogramPercentile(wait, 90.0) / NSEC_PER_USEC,
+            (double)histogramPercentile(wait, 99.0) / NSEC_PER_USEC,
+            (double)wait->max / NSEC_PER_USEC, (long long)(wait->count - unserved), (long long)unserved);
+  }
+
+  free(wait);
+}
+
+/**
+ * @brief Print report about placement of processes and Santa wake-up latency
+ */
+static void printPlacementReport()
+{
+  int failures = 0;
+  bool fifo = false;
+
+  LatencyHistogram *wake = calloc(1, sizeof(LatencyHistogram));
+  if (wake == NULL) return;
+
+  for (int w = 0; w < ctx->params.workshops; w++)
+  {
+    histogramMerge(wake, &ctx->workshops[w].sharedMemory.santaWakeLatency);
+    failures += ctx->workshops[w].sharedMemory.placementFailures;
+    fifo |= ctx->workshops[w].sharedMemory.santaFifo;
+  }
+
+  fprintf(stderr, "  placement:    santa cpu %d%s, log cpu %d, elf cpus %d (%s), %d failures\n",
+          ctx->params.santaCpu, fifo ? " SCHED_FIFO" : "", ctx->params.logCpu, ctx->params.elfCpuCount,
+          ctx->params.elfPlacement == PLACEMENT_BLOCK ? "block" : "roundrobin", failures);
+
+  if (wake->count > 0)
+  {
+    fprintf(stderr, "  santa wake:   avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%lld wake-ups)\n",
+            (double)wake->total / wake->count / NSEC_PER_USEC,
+            (double)histogramPercentile(wake, 50.0) / NSEC_PER_USEC,
+            (double)histogramPercentile(wake, 99.0) / NSEC_PER_USEC,
+            (double)wake->max / NSEC_PER_USEC, (long long)wake->count);
+  }
+
+  free(wake);
+}
+
+/**
+ * @brief Print report about cost of serving groups of elves
+ *
+ * Both modes count the same futex syscalls: blocking semaphore waits, posts to semaphores
+ * with blocked waiters and direct futex calls. Context switches are taken from all reaped
+ * child processes.
+ */
+static void printHandoffReport()
+{
+  int64_t groups = 0, syscalls = 0;
+  for (int w = 0; w < ctx->params.workshops; w++)
+  {
+    groups += ctx->workshops[w].sharedMemory.groupsServed;
+    syscalls += ctx->workshops[w].sharedMemory.handoffSyscalls;
+  }
+
+  struct rusage usage;
+  long switches = 0;
+  if (getrusage(RUSAGE_CHILDREN, &usage) == 0)
+    switches = usage.ru_nvcsw + usage.ru_nivcsw;
+
+  fprintf(stderr, "  handoff:      %s, %lld groups\n", handoffName(ctx->params.handoff), (long long)groups);
+  if (groups > 0)
+  {
+    fprintf(stderr, "  per group:    %.1f futex syscalls, %.1f context switches\n",
+            (double)syscalls / groups, (double)switches / groups);
+
+  }
+}
+
+/**
+ * @brief Print throughput between two marks
+ */
+static void printThroughput(const char *label, const SeasonMark *from, const SeasonMark *to)
+{
+  double seconds = (double)(to->time - from->time) / NSEC_PER_SEC;
+  int64_t events = to->events - from->events;
+  int64_t groups = to->groups - from->groups;
+
+  fprintf(stderr, "%s%.3f s, %lld events (%.1f/s), %lld groups (%.1f/s)\n", label, seconds,
+          (long long)events, seconds > 0 ? events / seconds : 0.0,
+          (long long)groups, seconds > 0 ? groups / seconds : 0.0);
+}
+
+/**
+ * @brief Print throughput of finished season, called by Santa at Christmas
+ *
+ * @param season number of finished season
+ * @param from progress at start of season
+ * @param to progress at Christmas
+ */
+void printSeasonReport(int season, const SeasonMark *from, const SeasonMark *to)
+{
+  char label[64];
+
+  if (ctx->params.workshops > 1)
+    snprintf(label, sizeof(label), "W%zu season %d: ", ctx->workshopIndex + 1, season);
+  else
+    snprintf(label, sizeof(label), "Season %d: ", season);
+
+  printThroughput(label, from, to);
+}
+
+/**
+ * @brief Print steady-state throughput of seasons following first one
+ *
+ * First season includes start of all processes and last Christmas is followed by shutdown,
+ * so throughput is measured from first to last Christmas
+ */
+static void printSteadyStateReport()
+{
+  SeasonMark from = { 0 }, to = { 0 };
+  int seasons = -1;
+
+  for (int w = 0; w < ctx->params.workshops; w++)
+  {
+    SharedMemory *mem = &ctx->workshops[w].sharedMemory;
+    if (seasons < 0 || mem->seasons < seasons)
+      seasons = mem->seasons;
+
+    // Workshops can run one after another, so their steady states are summed
+    to.time += mem->seasonStart.time - mem->firstChristmas.time;
+    to.events += mem->seasonStart.events - mem->firstChristmas.events;
+    to.groups += mem->seasonStart.groups - mem->firstChristmas.groups;
+  }
+
+  if (seasons < 2)
+    return;
+
+  fprintf(stderr, "  seasons:      %d\n", seasons);
+  printThroughput(ctx->params.workshops > 1 ? "  steady state: per workshop " : "  steady state: ", &from, &to);
+}
+
+/**
+ * @brief Print summary report of finished simulation to stderr
+ */
+void printReport()
+{
+  int64_t start = ctx->workshops[0].sharedMemory.startTime;
+  long events = 0;
+  for (int i = 0; i < ctx->params.workshops; i++)
+  {
+    events += ctx->workshops[i].sharedMemory.actionId - 1;
+    if (ctx->workshops[i].sharedMemory.startTime < start)
+      start = ctx->workshops[i].sharedMemory.startTime;
+  }
+
+  double runtime = (double)(monotonicTime() - start) / NSEC_PER_SEC;
+
+  fprintf(stderr, "Report:\n");
+  if (ctx->params.workshops > 1)
+    fprintf(stderr, "  workshops:    %d\n", ctx->params.workshops);
+  fprintf(stderr, "  runtime:      %.3f s\n", runtime);
+  fprintf(stderr, "  events:       %ld (%.1f/s)\n", events, runtime > 0 ? events / runtime : 0.0);
+  printTimingReport();
+  printFairnessReport();
+  printPlacementReport();
+  printHandoffReport();
+  printSteadyStateReport();
+
+  if (ctx->outputSink.memory != NULL)
+  {
+    size_t used = ctx->outputSink.memory->used - ctx->outputSink.memory->dropped;
+    fprintf(stderr, "  memory sink:  %zu bytes, %zu bytes dropped\n", used, ctx->outputSink.memory->dropped);
+  }
+}
@@ -0,0 +1,24 @@
+/**
+ * @file report.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for summary report of simulation
+ */
+
+#ifndef IOS_PROJECT2_REPORT_H
+#define IOS_PROJECT2_REPORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "timing.h"
+#include "latency.h"
+#include "admission.h"
+#include "handoff.h"
+
+void printSeasonReport(int season, const SeasonMark *from, const SeasonMark *to);
+void printReport();
+
+#endif //IOS_PROJECT2_REPORT_H
@@ -71,55 +71,168 @@ void destroySemaphore(sem_t *sem, ReturnCode *retVal)
     (*retVal) |= SEMAPHOR_DESTROY_ERROR;
 }
 
+/**
+ * @brief Destroy all semaphores of workshop
+ *
+ * @param workshop workshop to destroy
+ * @param retVal pointer to return code that will be returned based on previous state and success of this action
+ */
+void destroyWorkshop(Workshop *workshop, ReturnCode *retVal)
+{
+  SemHolder *sems = &workshop->semHolder;
+
+  destroySemaphore(&sems->writeOutLock, retVal);
+  destroySemaphore(&sems->rdWaitForHitch, retVal);
+  destroySemaphore(&sems->rdHitched, retVal);
+  destroySemaphore(&sems->waitForHelp, retVal);
+  destroySemaphore(&sems->waitInQueue, retVal);
+  destroySemaphore(&sems->elfHelped, retVal);
+  destroySemaphore(&sems->wakeForHelp, retVal);
+  destroySemaphore(&sems->santaReady, retVal);
+  destroySemaphore(&sems->childFinished, retVal);
+  destroySemaphore(&sems->rdReadyCountMutex, retVal);
+  destroySemaphore(&sems->elfQueueMutex, retVal);
+  destroySemaphore(&sems->christmasStarted, retVal);
+  destroySemaphore(&sems->numOfElvesStable, retVal);
+  destroySemaphore(&sems->rdVacation, retVal);
+
+  for (size_t i = 0; i < workshop->sharedMemory.elfCapacity; i++)
+    destroySemaphore(&workshop->elfSlots[i].admitted, retVal);
+}
+
+/**
+ * @brief Initialize semaphores and shared memory of workshop to default values
+ *
+ * @param workshop workshop to initialize
+ * @param slots array of elf slots of workshop
+ * @param capacity length of @p slots
+ * @param retVal pointer to return code that will be returned based on previous state and success of this action
+ */
+void initWorkshop(Workshop *workshop, ElfSlot *slots, size_t capacity, ReturnCode *retVal)
+{
+  SemHolder *sems = &workshop->semHolder;
+
+  initSemaphore(1, &sems->writeOutLock, retVal);
+  initSemaphore(0, &sems->rdWaitForHitch, retVal);
+  initSemaphore(0, &sems->rdHitched, retVal);
+  initSemaphore(0, &sems->waitForHelp, retVal);
+  initSemaphore(3, &sems->waitInQueue, retVal);
+  initSemaphore(0, &sems->elfHelped, retVal);
+  initSemaphore(0, &sems->wakeForHelp, retVal);
+  initSemaphore(0, &sems->santaReady, retVal);
+  initSemaphore(0, &sems->childFinished, retVal);
+  initSemaphore(1, &sems->rdReadyCountMutex, retVal);
+  initSemaphore(1, &sems->elfQueueMutex, retVal);
+  initSemaphore(0, &sems->christmasStarted, retVal);
+  initSemaphore(1, &sems->numOfElvesStable, retVal);
+  initSemaphore(0, &sems->rdVacation, retVal);
+
+  SharedMemory *mem = &workshop->sharedMemory;
+
+  mem->readyRDCount = 0;
+  mem->elfReadyQueue = 0;
+  mem->numberOfElves = 0;
+  mem->shopClosed = false;
+  mem->actionId = 1;
+  mem->startTime = monotonicTime();
+  memset(&mem->timing, 0, sizeof(TimingStats));
+  mem->elfCapacity = capacity;
+  mem->freeSeats = WORKSHOP_SEATS;
+  mem->waitingElves = 0;
+  mem->nextTicket = 0;
+  memset(&mem->waitLatency, 0, sizeof(LatencyHistogram));
+  mem->elvesUnserved = 0;
+
+  mem->wakeRequested = 0;
+  mem->santaSleepStart = 0;
+  memset(&mem->santaWakeLatency, 0, sizeof(LatencyHistogram));
+  mem->helpGeneration = 0;
+  mem->groupRemaining = 0;
+  mem->groupsDone = 0;
+  mem->groupsServed = 0;
+  mem->handoffSyscalls = 0;
+  memset(mem->semWaiters, 0, sizeof(mem->semWaiters));
+
+  mem->santaFifo = false;
+  mem->placementFailures = 0;
+  mem->reindeersBack = false;
+  mem->seasons = 0;
+  memset(&mem->seasonStart, 0, sizeof(SeasonMark));
+  memset(&mem->firstChristmas, 0, sizeof(SeasonMark));
+
+  workshop->elfSlots = slots;
+  memset(slots, 0, sizeof(ElfSlot) * capacity);
+  for (size_t i = 0; i < capacity; i++)
+    initSemaphore(0, &slots[i].admitted, retVal);
+}
+
+/**
+ * @brief Select workshop used by current process
+ *
+ * @param index index of workshop in arena
+ */
+void bindWorkshop(size_t index)
+{
+  ctx->workshopIndex = index;
+  ctx->semHolder = &ctx->workshops[index].semHolder;
+  ctx->sharedMemory = &ctx->workshops[index].sharedMemory;
+}
+
 /**
  * @brief Deallocates all memory used by semaphores and shared memory
  *
+ * Shared arena is destroyed only by process owning it, other processes release only their private resources
+ *
  * @return ReturnCode with NO_ERROR if it was successful or error code
  */
 ReturnCode deallocateResources()
 {
-  // Close output file
-  if (outputFile != NULL)
+  // Close private part of output sink
+  closeWorkshopSink();
+
+  if (ctx->processHolder.elfIds != NULL)
   {
-    fclose(outputFile);
-    outputFile = NULL;
+    free(ctx->processHolder.elfIds);
+    ctx->processHolder.elfIds = NULL;
+    ctx->processHolder.elvesCount = 0;
   }
 
-  if (processHolder.elfIds != NULL)
+  if (ctx->processHolder.rdIds != NULL)
   {
-    free(processHolder.elfIds);
-    processHolder.elfIds = NULL;
-    processHolder.elvesCount = 0;
+    free(ctx->processHolder.rdIds);
+    ctx->processHolder.rdIds = NULL;
+    ctx->processHolder.rdCount = 0;
   }
 
-  if (processHolder.rdIds != NULL)
+  if (ctx->processHolder.runnerIds != NULL)
   {
-    free(processHolder.rdIds);
-    processHolder.rdIds = NULL;
-    processHolder.rdCount = 0;
+    free(ctx->processHolder.runnerIds);
+    ctx->processHolder.runnerIds = NULL;
+    ctx->processHolder.runnerCount = 0;
   }
 
   ReturnCode retVal = NO_ERROR;
 
+  if (getpid() != ctx->processHolder.ownerId || ctx->workshops == NULL)
+    return retVal;
+
   // Destroy semafors
-  destroySemaphore(&semHolder->writeOutLock, &retVal);
-  destroySemaphore(&semHolder->rdWaitForHitch, &retVal);
-  destroySemaphore(&semHolder->rdHitched, &retVal);
-  destroySemaphore(&semHolder->waitForHelp, &retVal);
-  destroySemaphore(&semHolder->waitInQueue, &retVal);
-  destroySemaphore(&semHolder->elfHelped, &retVal);
-  destroySemaphore(&semHolder->wakeForHelp, &retVal);
-  destroySemaphore(&semHolder->santaReady, &retVal);
-  destroySemaphore(&semHolder->childFinished, &retVal);
-  destroySemaphore(&semHolder->rdReadyCountMutex, &retVal);
-  destroySemaphore(&semHolder->elfQueueMutex, &retVal);
-  destroySemaphore(&semHolder->christmasStarted, &retVal);
-  destroySemaphore(&semHolder->numOfElvesStable, &retVal);
-
-  destroySharedMemory((void**)&semHolder, sizeof(SemHolder), &retVal);
+  for (int i = 0; i < ctx->params.workshops; i++)
+    destroyWorkshop(&ctx->workshops[i], &retVal);
 
   // Destroy shared memory
-  destroySharedMemory((void**)&sharedMemory, sizeof(SharedMemory), &retVal);
+  void *slots = ctx->workshops[0].elfSlots;
+  destroySharedMemory(&slots, sizeof(ElfSlot) * ctx->workshops[0].sharedMemory.elfCapacity * ctx->params.workshops, &retVal);
+  destroySharedMemory((void**)&ctx->workshops, sizeof(Workshop) * ctx->params.workshops, &retVal);
+  ctx->semHolder = NULL;
+  ctx->sharedMemory = NULL;
+
+  // Close output sink
+  closeSink(&retVal);
+  closeTrace(&retVal);
+
+  // Unpublish statistics
+  destroyStatSegment(&retVal);
 
   if (retVal != NO_ERROR)
     return retVal;
@@ -130,42 +243,48 @@ ReturnCode deallocateResources()
 /**
  * @brief Allocates all needed semaphores and shared memory for running program
  *
+ * All workshops are allocated in one shared arena, first workshop is bound to current process
+ *
  * @return ReturnCode with NO_ERROR if it was successful or error code
  */
 ReturnCode allocateResources()
 {
   ReturnCode retVal = NO_ERROR;
 
-  // Create semaphores
-  semHolder = createSharedMemory(sizeof(SemHolder), &retVal);
+  ctx->processHolder.ownerId = getpid();
+
+  // Create shared memory
+  ctx->workshops = createSharedMemory(sizeof(Workshop) * ctx->params.workshops, &retVal);
   if (retVal != NO_ERROR) return retVal;
 
-  initSemaphore(1, &semHolder->writeOutLock, &retVal);
-  initSemaphore(0, &semHolder->rdWaitForHitch, &retVal);
-  initSemaphore(0, &semHolder->rdHitched, &retVal);
-  initSemaphore(0, &semHolder->waitForHelp, &retVal);
-  initSemaphore(3, &semHolder->waitInQueue, &retVal);
-  initSemaphore(0, &semHolder->elfHelped, &retVal);
-  initSemaphore(0, &semHolder->wakeForHelp, &retVal);
-  initSemaphore(0, &semHolder->santaReady, &retVal);
-  initSemaphore(0, &semHolder->childFinished, &retVal);
-  initSemaphore(1, &semHolder->rdReadyCountMutex, &retVal);
-  initSemaphore(1, &semHolder->elfQueueMutex, &retVal);
-  initSemaphore(0, &semHolder->christmasStarted, &retVal);
-  initSemaphore(1, &semHolder->numOfElvesStable, &retVal);
+  // Elves can be added on signal only up to MAX_ELVES
+  size_t capacity = ctx->params.bflag ? MAX_ELVES : (size_t)ctx->params.ne;
+  ElfSlot *slots = createSharedMemory(sizeof(ElfSlot) * capacity * ctx->params.workshops, &retVal);
+  if (retVal != NO_ERROR)
+  {
+    destroySharedMemory((void**)&ctx->workshops, sizeof(Workshop) * ctx->params.workshops, &retVal);
+    return retVal;
+  }
+
+  // Create semaphores and init shared memory
+  for (int i = 0; i < ctx->params.workshops; i++)
+    initWorkshop(&ctx->workshops[i], slots + capacity * i, capacity, &retVal);
 
   if (retVal != NO_ERROR) return retVal;
 
-  // Create shared memory
-  sharedMemory = createSharedMemory(sizeof(SharedMemory), &retVal);
+  bindWorkshop(0);
+
+  // Open output sink
+  retVal = openSink();
+  if (retVal != NO_ERROR) return retVal;
+
+  // Open trace
+  retVal = openTrace();
   if (retVal != NO_ERROR) return retVal;
 
-  // Init shared memory
-  sharedMemory->readyRDCount = 0;
-  sharedMemory->elfReadyQueue = 0;
-  sharedMemory->numberOfElves = 0;
-  sharedMemory->shopClosed = false;
-  sharedMemory->actionId = 1;
+  // Publish statistics segment
+  if (ctx->params.statName != NULL)
+    return createStatSegment(ctx->params.statName);
 
   return NO_ERROR;
 }
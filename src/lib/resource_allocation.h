@@ -15,9 +15,17 @@
 #include <semaphore.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
 
 #include "shared_resources.h"
+#include "statistics.h"
+#include "timing.h"
+#include "output_sink.h"
+#include "admission.h"
+#include "trace.h"
 
+void bindWorkshop(size_t index);
 ReturnCode deallocateResources();
 ReturnCode allocateResources();
 
@@ -0,0 +1,155 @@
+/**
+ * @file santa.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Embeddable simulation library returning error codes instead of exiting
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "santa.h"
+#include "shared_resources.h"
+#include "resource_allocation.h"
+#include "workshop.h"
+#include "utils.h"
+
+/**
+ * @struct santa_sim
+ * @brief Simulation context
+ */
+struct santa_sim
+{
+  SimContext context;             /**< State of simulation bound to ctx while it runs */
+  char *outputPath;               /**< Owned copy of output path or NULL */
+  SantaEventCallback onEvent;     /**< Event callback or NULL */
+  void *userData;                 /**< Pointer passed to callback */
+  int running;                    /**< Set while this context runs */
+};
+
+/**
+ * @brief Create simulation context from @p config
+ *
+ * @param config configuration of simulation
+ * @param sim output pointer to created context
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode santa_sim_create(const SantaConfig *config, SantaSim **sim)
+{
+  if (config == NULL || sim == NULL)
+    return INVALID_ARGUMENT_ERROR;
+
+  Params prm = { 0 };
+  prm.ne = config->ne;
+  prm.nr = config->nr;
+  prm.te = config->te;
+  prm.tr = config->tr;
+  prm.timeScale = (config->timeScale == 0.0) ? 1.0 : config->timeScale;
+  prm.workshops = 1;
+  prm.policy = config->policy;
+  prm.handoff = config->handoff;
+  prm.seasons = (config->seasons == 0) ? 1 : config->seasons;
+  prm.santaCpu = -1;
+  prm.logCpu = -1;
+  prm.sinkType = (config->outputPath != NULL) ? SINK_FILE : SINK_NULL;
+
+  ReturnCode retVal = validateParams(&prm);
+  if (retVal != NO_ERROR)
+    return retVal;
+
+  SantaSim *tmp = (SantaSim *)calloc(1, sizeof(SantaSim));
+  if (tmp == NULL)
+    return MEMORY_ALLOCATION_ERROR;
+
+  if (config->outputPath != NULL && (tmp->outputPath = strdup(config->outputPath)) == NULL)
+  {
+    free(tmp);
+    return MEMORY_ALLOCATION_ERROR;
+  }
+
+  initContext(&tmp->context);
+  tmp->context.params = prm;
+  tmp->context.params.sinkTarget = tmp->outputPath;
+  tmp->onEvent = config->onEvent;
+  tmp->userData = config->userData;
+
+  *sim = tmp;
+  return NO_ERROR;
+}
+
+/**
+ * @brief Run simulation and wait until it ends
+ *
+ * Can be called repeatedly, each call runs new independent simulation.
+ * Different contexts can run at the same time from different threads or
+ * from event callback of another context. Only call on context that is
+ * already running fails with SIMULATION_BUSY_ERROR.
+ *
+ * @param sim simulation context
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode santa_sim_run(SantaSim *sim)
+{
+  if (sim == NULL)
+    return INVALID_ARGUMENT_ERROR;
+
+  if (__atomic_exchange_n(&sim->running, 1, __ATOMIC_ACQUIRE) != 0)
+    return SIMULATION_BUSY_ERROR;
+
+  Params prm = sim->context.params;
+  initContext(&sim->context);
+  sim->context.params = prm;
+
+  SimContext *outer = ctx;
+  ctx = &sim->context;
+  ctx->processHolder.mainId = getpid();
+
+  ReturnCode retVal = allocateResources();
+  if (retVal == NO_ERROR)
+    retVal = runWorkshop(0, sim->onEvent, sim->userData);
+
+  retVal |= deallocateResources();
+  ctx = outer;
+  __atomic_store_n(&sim->running, 0, __ATOMIC_RELEASE);
+  return retVal;
+}
+
+
+/**
+ * @brief Destroy simulation context
+ *
+ * @param sim simulation context, can be NULL
+ */
+void santa_sim_destroy(SantaSim *sim)
+{
+  if (sim == NULL) return;
+
+  free(sim->outputPath);
+  free(sim);
+}
+
+/**
+ * @brief Get description of first error in @p code
+ *
+ * @param code return code of library function
+ * @return static string describing error
+ */
+const char *santa_strerror(ReturnCode code)
+{
+  if (code == NO_ERROR) return "No error";
+  if (code & ARGUMENT_COUNT_ERROR) return "Invalid argument count";
+  if (code & INVALID_ARGUMENT_ERROR) return "Invalid argument";
+  if (code & SEMAPHOR_INIT_FAILED) return "Failed to initialize semaphores";
+  if (code & SEMAPHOR_DESTROY_ERROR) return "Failed to destroy semaphores";
+  if (code & SM_CREATE_ERROR) return "Failed to allocate shared memory";
+  if (code & SM_DESTROY_ERROR) return "Failed to deallocate shared memory";
+  if (code & PROCESS_CREATE_ERROR) return "Failed to create new process";
+  if (code & OF_OPEN_ERROR) return "Failed to open output file";
+  if (code & PID_ALLOCATION_ERROR) return "Failed to allocate memory for pid arrays";
+  if (code & MEMORY_ALLOCATION_ERROR) return "Failed to allocate memory";
+  if (code & PIPE_CREATE_ERROR) return "Failed to create event pipe";
+  if (code & NETWORK_ERROR) return "Network communication failed";
+  if (code & SIMULATION_BUSY_ERROR) return "Simulation is already running";
+  return "Unexpected error";
+}
@@ -0,0 +1,60 @@
+/**
+ * @file santa.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Public interface of embeddable simulation library (libsanta)
+ *
+ * All state of one run (shared memory, semaphores, output sink, event pipe, trace file and
+ * process table) lives in its SantaSim, so different simulations can run at the same time
+ * from different threads or from event callback of another simulation. Only running same
+ * SantaSim twice at once fails with SIMULATION_BUSY_ERROR.
+ *
+ * Entities still run in forked child processes of calling process (without exec), because
+ * they synchronize through process shared semaphores and futexes in shared memory exactly
+ * like in program, events are delivered back to calling thread through callback. Calling
+ * process must not reap children it did not create itself (e.g. by waiting for any child).
+ *
+ * Only functions marked with SANTA_API are exported, all other symbols of library are hidden.
+ */
+
+#ifndef IOS_PROJECT2_SANTA_H
+#define IOS_PROJECT2_SANTA_H
+
+#include "static_constructions.h"
+
+/**
+ * @brief Marks function exported from library
+ */
+#define SANTA_API __attribute__((visibility("default")))
+
+/**
+ * @struct santa_config
+ * @brief Configuration of simulation
+ */
+typedef struct santa_config
+{
+  int ne;                         /**< Number of elves */
+  int nr;                         /**< Number of reindeers */
+  int te;                         /**< Max work time of elf in microseconds */
+  int tr;                         /**< Max vacation time of reindeer in microseconds */
+  double timeScale;               /**< Factor applied to all waiting times, 0 for default 1.0 */
+  AdmissionPolicy policy;         /**< Policy for admitting elves to workshop */
+  HandoffMode handoff;            /**< Protocol of serving group of elves */
+  int seasons;                    /**< Number of seasons, 0 for default 1 */
+  const char *outputPath;         /**< Path of output file, NULL for no output file */
+  SantaEventCallback onEvent;     /**< Callback receiving all events, NULL when not used */
+  void *userData;                 /**< Pointer passed to callback */
+} SantaConfig;
+
+/**
+ * @brief Opaque simulation context
+ */
+typedef struct santa_sim SantaSim;
+
+SANTA_API ReturnCode santa_sim_create(const SantaConfig *config, SantaSim **sim);
+SANTA_API ReturnCode santa_sim_run(SantaSim *sim);
+SANTA_API void santa_sim_destroy(SantaSim *sim);
+SANTA_API const char *santa_strerror(ReturnCode code);
+
+
+#endif //IOS_PROJECT2_SANTA_H
@@ -7,11 +7,19 @@
 
 #include "shared_resources.h"
 
-ProcessHolder processHolder = { 0 };            /**< Holder for all information about process ids and its count */
-
-Params params;                                  /**< Holder for parsed arguments */
+/**
+ * @brief Context of program, library binds context of its SantaSim instead
+ */
+static SimContext programContext = SIM_CONTEXT_INIT;
 
-SemHolder *semHolder = NULL;                    /**< Pointer to shared holder for semaphores */
-volatile SharedMemory *sharedMemory = NULL;     /**< Pointer to shared memory holder */
+__thread SimContext *ctx = &programContext;      /**< Context of simulation run by this thread */
 
-FILE *outputFile = NULL;                        /**< Output stream pointer */
\ No newline at end of file
+/**
+ * @brief Reset @p context to state before first run
+ *
+ * @param context context to reset
+ */
+void initContext(SimContext *context)
+{
+  *context = (SimContext)SIM_CONTEXT_INIT;
+}
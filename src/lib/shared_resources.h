@@ -2,7 +2,12 @@
  * @file shared_resources.h
  * @author Martin Douša
  * @date April 2021
- * @brief Holds definitions shared global variables and structures
+ * @brief Holds pointer to context of running simulation
+
+ *
+ * All state of simulation lives in SimContext. Code reaches context of simulation run by
+ * current thread through ctx, so independent simulations can run in different threads and
+ * forked processes keep pointer to their own copy.
  */
 
 #ifndef IOS_PROJECT2_SHARED_RESOURCES_H
@@ -13,12 +18,13 @@
 
 #include "static_constructions.h"
 
-extern SemHolder *semHolder;
-extern volatile SharedMemory *sharedMemory;
+/**
+ * @brief Initializer of SimContext before first run
+ */
+#define SIM_CONTEXT_INIT { .outputSink = { -1, 0, NULL }, .eventPipe = -1, .eventPipeRead = -1, .traceFd = -1, .probeId = -1 }
+
+extern __thread SimContext *ctx;
 
-// Mic
-extern Params params;
-extern FILE *outputFile;
-extern ProcessHolder processHolder;
+void initContext(SimContext *context);
 
 #endif //IOS_PROJECT2_SHARED_RESOURCES_H
@@ -19,6 +19,7 @@
 typedef struct process_holder
 {
   pid_t mainId;                   /**< Process id of main process (available for all child processes) */
+  pid_t ownerId;                  /**< Process id of process owning shared resources */
   
   pid_t *elfIds;                  /**< Array of process ids for all elves */
   size_t elvesCount;              /**< Length of elf ids array */
@@ -27,6 +28,9 @@ typedef struct process_holder
   size_t rdCount;                 /**< Length of reindeer ids array */
 
   pid_t santaId;                  /**< Process id of Santa process */
+
+  pid_t *runnerIds;               /**< Array of process ids for workshop runners */
+  size_t runnerCount;             /**< Length of runner ids array */
 } ProcessHolder;
 
 /**
@@ -41,15 +45,101 @@ typedef struct sem_holder
   sem_t waitInQueue;              /**< Semaphore for elves to queue when Santa is helping another 3 elves */
   sem_t waitForHelp;              /**< Semaphore for elves that are on the front of queue and will get help from Santa */
   sem_t elfHelped;                /**< Semaphore for indicating that elf get help */
-  sem_t wakeForHelp;              /**< Semaphore for third elf in queue to wake up Santa for helping */
+  sem_t wakeForHelp;              /**< Semaphore for third elf in queue or last returned reindeer to wake up Santa */
   sem_t santaReady;               /**< Semaphore signalizing that Santa is not doing something else and can be woken up */
   sem_t childFinished;            /**< Semaphore signalizing exiting of child process */
   sem_t rdReadyCountMutex;        /**< Mutex for handling ready reindeers */
   sem_t elfQueueMutex;            /**< Mutex for managing elf queue */
   sem_t christmasStarted;         /**< Semaphore signalizing that Christmas started */
   sem_t numOfElvesStable;         /**< Semaphore to signalize that number of elves will not change */
+  sem_t rdVacation;               /**< Semaphore for hitched reindeers to go on vacation in next season */
 } SemHolder;
 
+/**
+ * @struct timing_stats
+ * @brief Accumulated precision of sleeps
+ */
+typedef struct timing_stats
+{
+  int64_t sleepCount;             /**< Number of performed sleeps */
+  int64_t requestedTotal;         /**< Sum of requested sleep durations in nanoseconds */
+  int64_t overshootTotal;         /**< Sum of overshoots of deadlines in nanoseconds */
+  int64_t overshootMax;           /**< Maximal overshoot of deadline in nanoseconds */
+} TimingStats;
+
+#define LATENCY_SUB_BITS 4                                        /**< Log2 of linear buckets per power of two */
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)               /**< Linear buckets per power of two */
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS) * LATENCY_SUB_BUCKETS) /**< Number of buckets in histogram */
+
+/**
+ * @struct latency_histogram
+ * @brief Log-linear histogram of latencies in nanoseconds
+ */
+typedef struct latency_histogram
+{
+  int64_t buckets[LATENCY_BUCKETS]; /**< Number of values in each bucket */
+  int64_t count;                  /**< Number of values */
+  int64_t total;                  /**< Sum of values */
+  int64_t max;                    /**< Maximal value */
+} LatencyHistogram;
+
+/**
+ * @brief Policies for admitting elves to workshop
+ */
+typedef enum admissionPolicy
+{
+  POLICY_NONE = 0,                /**< Elves race for counting semaphore without ordering */
+  POLICY_FIFO = 1,                /**< Elves are admitted in order of arrival (tickets) */
+  POLICY_LIFO = 2,                /**< Latest arrived elf is admitted first */
+  POLICY_LWF = 3,                 /**< Elf with longest total waiting time is admitted first */
+  POLICY_FAIR = 4,                /**< Elf with least received helps is admitted first */
+} AdmissionPolicy;
+
+/**
+ * @brief Protocols of serving group of elves
+ */
+typedef enum handoffMode
+{
+  HANDOFF_CLASSIC = 0,            /**< Per elf semaphore posts in both directions */
+  HANDOFF_GROUP = 1,              /**< One wake of whole group and one completion wake-up */
+} HandoffMode;
+
+/**
+ * @brief Patterns of spreading elves over CPU set
+ */
+typedef enum elfPlacement
+{
+  PLACEMENT_ROUND_ROBIN = 0,      /**< Elf i is placed on CPU i % n of set */
+  PLACEMENT_BLOCK = 1,            /**< Elves are split to contiguous blocks, one block per CPU */
+} ElfPlacement;
+
+#define CPU_MASK_WORDS 16         /**< Number of 64 bit words in CPU masks (1024 CPUs) */
+
+/**
+ * @struct elf_slot
+ * @brief Per elf shared state used for admission and fairness statistics
+ */
+typedef struct elf_slot
+{
+  sem_t admitted;                 /**< Semaphore for elf waiting in admission queue */
+  bool waiting;                   /**< Elf waits in admission queue */
+  uint64_t ticket;                /**< Arrival ticket of elf in admission queue */
+  int64_t queuedSince;            /**< Time when elf started to need help in nanoseconds */
+  int64_t waitedTotal;            /**< Total time elf waited for help in nanoseconds */
+  int64_t helps;                  /**< Number of helps received by elf */
+} ElfSlot;
+
+/**
+ * @struct season_mark
+ * @brief Progress of workshop at Christmas
+ */
+typedef struct season_mark
+{
+  int64_t time;                   /**< CLOCK_MONOTONIC time in nanoseconds */
+  int64_t events;                 /**< Number of printed events */
+  int64_t groups;                 /**< Number of served groups of elves */
+} SeasonMark;
+
 /**
  * @struct shared_memory
  * @brief Struct for holding shared memory
@@ -60,9 +150,79 @@ typedef struct shared_memory
   int elfReadyQueue;              /**< Counter for elves ready to get help */
   size_t numberOfElves;           /**< Mirror of allocated elves (security reasons) */
   bool shopClosed;                /**< Flag representing if workshop is closed */
-  int actionId;                   /**< Action counter for output line indexing */
+  int64_t actionId;               /**< Action counter for output line indexing */
+  int64_t startTime;              /**< CLOCK_MONOTONIC time of start of simulation in nanoseconds */
+  TimingStats timing;             /**< Measured precision of sleeps */
+  size_t elfCapacity;             /**< Number of allocated elf slots */
+  int freeSeats;                  /**< Free places in workshop for admission policies */
+  int waitingElves;               /**< Number of elves in admission queue */
+  uint64_t nextTicket;            /**< Next arrival ticket of admission queue */
+  LatencyHistogram waitLatency;   /**< Time from "need help" to "get help" or to closing of workshop */
+  int64_t elvesUnserved;          /**< Elves sent home from queue at closing, their waits are in waitLatency */
+
+  int64_t wakeRequested;          /**< Time when Santa was woken up to help elves */
+  int64_t santaSleepStart;        /**< Time when Santa started waiting for wake-up */
+  LatencyHistogram santaWakeLatency; /**< Time from waking sleeping Santa to Santa running */
+  uint32_t helpGeneration;        /**< Futex incremented by Santa to release waiting group */
+  uint32_t groupRemaining;        /**< Number of elves of served group that didn't get help yet */
+  uint32_t groupsDone;            /**< Futex incremented by last elf of served group */
+  int64_t groupsServed;           /**< Number of served groups */
+  int64_t handoffSyscalls;        /**< Futex syscalls of group service in both modes, counted with report */
+  uint32_t semWaiters[sizeof(SemHolder) / sizeof(sem_t)]; /**< Processes blocked in handoffWait() on each semaphore of SemHolder */
+
+  bool santaFifo;                 /**< Santa runs under SCHED_FIFO */
+  int placementFailures;          /**< Number of failed placements of processes */
+  bool reindeersBack;             /**< Flag set by last returned reindeer, Santa handles it before elves */
+  int seasons;                    /**< Number of finished seasons */
+  SeasonMark seasonStart;         /**< Progress at start of current season */
+  SeasonMark firstChristmas;      /**< Progress at end of first season */
 } SharedMemory;
 
+/**
+ * @struct workshop
+ * @brief Holds all shared state of one independent simulation
+ */
+typedef struct workshop
+{
+  SemHolder semHolder;            /**< Semaphores of workshop */
+  SharedMemory sharedMemory;      /**< Shared memory of workshop */
+  ElfSlot *elfSlots;              /**< Slots of elves indexed by elf id - 1 */
+} Workshop;
+
+/**
+ * @brief States of elf tracked in statistics segment
+ */
+typedef enum elfState
+{
+  ELF_WORKING = 0,                /**< Elf is working on his own */
+  ELF_QUEUED = 1,                 /**< Elf needs help and waits in queue */
+  ELF_HELPED = 2,                 /**< Elf is being helped by Santa */
+  ELF_HOLIDAYS = 3,               /**< Elf is taking holidays */
+  ELF_STATE_COUNT = 4,            /**< Number of tracked elf states */
+} ElfState;
+
+/**
+ * @struct stat_segment
+ * @brief Named read-only statistics segment published for external tools
+ *
+ * All counters are updated with atomic operations so readers can attach at any time
+ */
+typedef struct stat_segment
+{
+  uint32_t magic;                 /**< Magic number identifying segment */
+  uint32_t version;               /**< Layout version of segment */
+  pid_t ownerId;                  /**< Process id of main process that published segment */
+  int nr;                         /**< Number of reindeers in one workshop */
+  int workshops;                  /**< Number of workshops in simulation */
+  int64_t startTime;              /**< CLOCK_MONOTONIC time of publishing in nanoseconds */
+  int64_t elves[ELF_STATE_COUNT]; /**< Number of elves in each ElfState */
+  int64_t groupsServed;           /**< Number of groups of elves helped by Santa */
+  int64_t rdReturned;             /**< Number of reindeers returned from vacation in current season */
+  int64_t seasons;                /**< Number of finished seasons summed over all workshops */
+  int64_t actionId;               /**< Number of printed actions in all workshops */
+  int32_t finished;               /**< Flag signalizing that simulation ended */
+} StatSegment;
+
 /**
  * @brief Holds all available return codes
  */
@@ -79,8 +239,109 @@ typedef enum returnCode
   OF_OPEN_ERROR = 128,            /**< Failed to open output file */
   PID_ALLOCATION_ERROR = 256,     /**< Failed to allocate store for process ids */
   UNEXPECTED_ERROR = 512,         /**< Unknown error that should't happen */
+  MEMORY_ALLOCATION_ERROR = 1024, /**< Failed to allocate memory */
+  PIPE_CREATE_ERROR = 2048,       /**< Failed to create pipe for events */
+  NETWORK_ERROR = 4096,           /**< Failed to communicate with remote workshop */
+  SIMULATION_BUSY_ERROR = 8192,   /**< Simulation context is already running */
+
 } ReturnCode;
 
+/**
+ * @brief Types of output sinks
+ */
+typedef enum sinkType
+{
+  SINK_FILE = 0,                  /**< Write lines to file */
+  SINK_STDOUT = 1,                /**< Write lines to standard output */
+  SINK_PIPE = 2,                  /**< Write lines to standard input of external consumer command */
+  SINK_MEMORY = 3,                /**< Format lines into shared memory buffer */
+  SINK_NULL = 4,                  /**< Drop lines without formatting them */
+} SinkType;
+
+/**
+ * @struct memory_sink
+ * @brief Shared buffer of memory sink
+ */
+typedef struct memory_sink
+{
+  size_t capacity;                /**< Size of data buffer */
+  size_t used;                    /**< Number of bytes reserved in buffer */
+  size_t dropped;                 /**< Number of bytes that didn't fit into buffer */
+  char data[];                    /**< Formatted output */
+} MemorySink;
+
+/**
+ * @struct output_sink
+ * @brief Runtime state of output sink
+ */
+typedef struct output_sink
+{
+  int fd;                         /**< File descriptor for file, stdout and pipe sinks, -1 when closed */
+  pid_t consumerId;               /**< Process id of consumer of pipe sink */
+  MemorySink *memory;             /**< Shared buffer of memory sink */
+} OutputSink;
+
+/**
+ * @struct santa_event
+ * @brief One line of simulation output delivered to event callback
+ *
+ * Strings point to static data shared by all processes of simulation
+ */
+typedef struct santa_event
+{
+  int64_t actionId;               /**< Action id of event */
+  const char *entity;             /**< Name of entity ("Elf", "RD" or "Santa") */
+  int id;                         /**< Id of entity, NO_ID for Santa */
+  const char *message;            /**< Message of event */
+} SantaEvent;
+
+/**
+ * @brief Callback receiving events of simulation in calling process
+ */
+typedef void (*SantaEventCallback)(const SantaEvent *event, void *userData);
+
+/**
+ * @brief Messages of network protocol between Santa server and clients hosting elves and reindeers
+ */
+typedef enum netMessage
+{
+  NET_HELLO = 1,                  /**< Client registers id = number of elves and arg = number of reindeers */
+  NET_WELCOME = 2,                /**< Server assigns id = first elf id and arg = first reindeer id */
+  NET_REJECT = 3,                 /**< Server has no free ids for client */
+  NET_ELF_START = 4,              /**< Elf started */
+  NET_ELF_NEED_HELP = 5,          /**< Elf needs help */
+  NET_ELF_HELPED = 6,             /**< Elf got help and goes to work */
+  NET_ELF_HOLIDAYS = 7,           /**< Elf takes holidays */
+  NET_RD_START = 8,               /**< Reindeer started */
+  NET_RD_RETURN = 9,              /**< Reindeer returned home */
+  NET_RD_HITCHED = 10,            /**< Reindeer got hitched */
+} NetMessage;
+
+#define NET_RECORD_SIZE 12        /**< Size of one record on wire, three 32-bit words in network byte order */
+
+/**
+ * @struct net_record
+ * @brief Decoded record of network protocol
+ */
+typedef struct net_record
+{
+  uint32_t type;                  /**< Type of message, NetMessage */
+  uint32_t id;                    /**< Id of entity */
+  uint32_t arg;                   /**< Argument of message */
+} NetRecord;
+
+/**
+ * @struct net_buffer
+ * @brief Growing buffer of encoded records waiting for write
+ */
+typedef struct net_buffer
+{
+  char *data;                     /**< Encoded records */
+  size_t used;                    /**< Number of valid bytes */
+  size_t sent;                    /**< Number of already written bytes */
+  size_t capacity;                /**< Allocated size of data */
+} NetBuffer;
+
 /**
  * @struct prmtrs
  * @brief Holds all parameters extracted from arguments
@@ -89,9 +350,61 @@ typedef struct prmtrs
 {
   int ne;                         /**< Number of elves to generate */
   int nr;                         /**< Number of reindeers to generate */
-  int te;                         /**< Max work time of elf */
-  int tr;                         /**< Max vacation time of reindeer */
+  int te;                         /**< Max work time of elf in microseconds */
+  int tr;                         /**< Max vacation time of reindeer in microseconds */
+  double timeScale;               /**< Factor applied to all waiting times */
+  bool report;                    /**< Print summary report to stderr at the end */
+  int workshops;                  /**< Number of independent workshops to simulate */
+  SinkType sinkType;              /**< Type of output sink */
+  char *sinkTarget;               /**< File path or consumer command of output sink */
+  size_t sinkMemorySize;          /**< Size of buffer of memory sink */
+  AdmissionPolicy policy;         /**< Policy for admitting elves to workshop */
   bool bflag;                     /**< Extension flag for generating more elves on USR1 signal */
+  char *statName;                 /**< Name of published statistics segment (NULL when disabled) */
+  int santaCpu;                   /**< CPU for Santa, -1 when not pinned */
+  int logCpu;                     /**< CPU for main process and pipe consumer, -1 when not pinned */
+  uint64_t elfCpus[CPU_MASK_WORDS]; /**< Set of CPUs for elves */
+  int elfCpuCount;                /**< Number of CPUs in elf set, 0 when not pinned */
+  ElfPlacement elfPlacement;      /**< Pattern of spreading elves over elf set */
+  int santaFifoPriority;          /**< SCHED_FIFO priority of Santa, 0 for default scheduling */
+  HandoffMode handoff;            /**< Protocol of serving group of elves */
+  int seasons;                    /**< Number of seasons to simulate, 0 for unlimited */
+  double duration;                /**< Seconds after which current season is the last one, 0 for unlimited */
+  const char *tracePath;          /**< Path of Chrome trace file, NULL when not traced */
+  const char *serveAddress;       /**< Address where Santa serves remote clients, NULL when local */
+  const char *connectAddress;     /**< Address of Santa server for hosted elves and reindeers, NULL when local */
+  bool plan;                      /**< Search largest number of elves up to NE meeting SLO */
+  double sloP99;                  /**< SLO of 99th percentile of wait for help in milliseconds */
 } Params;
 
+/**
+ * @struct sim_context
+ * @brief State of one simulation run
+ *
+ * Program has one context, library keeps one in every SantaSim. Forked processes work
+ * with their own copy of context of process that created them.
+ */
+typedef struct sim_context
+{
+  Params params;                  /**< Parsed parameters of simulation */
+  ProcessHolder processHolder;    /**< Ids and counts of created processes */
+  Workshop *workshops;            /**< Arena holding shared state of all workshops */
+  SemHolder *semHolder;           /**< Semaphores of workshop bound to this process */
+  volatile SharedMemory *sharedMemory; /**< Shared memory of workshop bound to this process */
+  size_t workshopIndex;           /**< Index of workshop bound to this process */
+  StatSegment *statSegment;       /**< Published statistics segment, NULL when not published */
+  char statSegmentName[256];      /**< Name under which statistics segment was published */
+  OutputSink outputSink;          /**< Runtime state of output sink */
+  int eventPipe;                  /**< Write end of pipe delivering events to calling process */
+  int eventPipeRead;              /**< Read end of event pipe in calling process */
+  int traceFd;                    /**< Trace file shared by all processes */
+  int64_t traceEpoch;             /**< Time of opening trace, all timestamps are relative to it */
+  const char *traceState;         /**< Trace state of entity of this process */
+  int64_t traceStateStart;        /**< Time when trace state of entity started */
+  int probeRole;                  /**< Role of entity of this process passed to probes */
+  int probeId;                    /**< Id of entity of this process passed to probes */
+  bool notified;                  /**< Main process was already notified about failure */
+} SimContext;
+
+
 #endif //IOS_PROJECT2_STATIC_CONSTRUCTIONS_H
@@ -0,0 +1,103 @@
+/**
+ * @file statistics.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Publishing of live statistics segment
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "statistics.h"
+
+/**
+ * @brief Publish named statistics segment
+ *
+ * Segment is created as POSIX shared memory object so external tools can attach to it read-only
+ *
+ * @param name name of segment (leading slash is added when missing)
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode createStatSegment(const char *name)
+{
+  if (name[0] == '/')
+    snprintf(ctx->statSegmentName, sizeof(ctx->statSegmentName), "%s", name);
+  else
+    snprintf(ctx->statSegmentName, sizeof(ctx->statSegmentName), "/%s", name);
+
+  int fd = shm_open(ctx->statSegmentName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+  {
+    ctx->statSegmentName[0] = 0;
+    return SM_CREATE_ERROR;
+  }
+
+  if (ftruncate(fd, sizeof(StatSegment)) == -1)
+  {
+    close(fd);
+    shm_unlink(ctx->statSegmentName);
+    ctx->statSegmentName[0] = 0;
+    return SM_CREATE_ERROR;
+  }
+
+  void *mem = mmap(NULL, sizeof(StatSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (mem == MAP_FAILED)
+  {
+    shm_unlink(ctx->statSegmentName);
+    ctx->statSegmentName[0] = 0;
+    return SM_CREATE_ERROR;
+  }
+
+  ctx->statSegment = mem;
+  memset(ctx->statSegment, 0, sizeof(StatSegment));
+  ctx->statSegment->ownerId = getpid();
+  ctx->statSegment->nr = ctx->params.nr;
+  ctx->statSegment->workshops = ctx->params.workshops;
+  ctx->statSegment->startTime = monotonicTime();
+  ctx->statSegment->version = STAT_SEGMENT_VERSION;
+
+  // Magic is written last so readers never see half initialized segment
+  __atomic_store_n(&ctx->statSegment->magic, STAT_SEGMENT_MAGIC, __ATOMIC_RELEASE);
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Mark statistics segment as finished, unmap and unlink it
+ *
+ * @param retVal pointer to return code that will be returned based on previous state and success of this action
+ */
+void destroyStatSegment(ReturnCode *retVal)
+{
+  if (ctx->statSegment == NULL) return;
+
+  __atomic_store_n(&ctx->statSegment->finished, 1, __ATOMIC_RELEASE);
+
+  if (munmap(ctx->statSegment, sizeof(StatSegment)) == -1)
+    (*retVal) |= SM_DESTROY_ERROR;
+  ctx->statSegment = NULL;
+
+  if (ctx->statSegmentName[0] != 0 && shm_unlink(ctx->statSegmentName) == -1)
+    (*retVal) |= SM_DESTROY_ERROR;
+  ctx->statSegmentName[0] = 0;
+}
+
+/**
+ * @brief Move elf from state @p current to state @p next in statistics
+ *
+ * @param current pointer to current state of elf, updated to @p next
+ * @param next new state of elf
+ */
+void changeElfState(ElfState *current, ElfState next)
+{
+  if (*current == next) return;
+
+  STAT_ADD(elves[*current], -1);
+  STAT_ADD(elves[next], 1);
+  *current = next;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file statistics.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for publishing live statistics
+ */
+
+#ifndef IOS_PROJECT2_STATISTICS_H
+#define IOS_PROJECT2_STATISTICS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "timing.h"
+
+#define STAT_SEGMENT_MAGIC 0x53414e54   /**< "SANT" */
+#define STAT_SEGMENT_VERSION 2
+#define STAT_DEFAULT_NAME "/proj2-stat"
+
+/**
+ * @brief Atomically add @p value to @p field of statistics segment if it is published
+ */
+#define STAT_ADD(field, value) \
+  do { if (ctx->statSegment != NULL) __atomic_add_fetch(&ctx->statSegment->field, (value), __ATOMIC_RELAXED); } while (0)
+
+ReturnCode createStatSegment(const char *name);
+void destroyStatSegment(ReturnCode *retVal);
+void changeElfState(ElfState *current, ElfState next);
+
+#endif //IOS_PROJECT2_STATISTICS_H
@@ -0,0 +1,74 @@
+/**
+ * @file timing.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief High resolution waiting on absolute monotonic deadlines
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "timing.h"
+
+/**
+ * @brief Get current time of monotonic clock
+ *
+ * @return time in nanoseconds
+ */
+int64_t monotonicTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * @brief Sleep until absolute CLOCK_MONOTONIC @p deadline
+ *
+ * Measured overshoot of deadline is accumulated in shared timing statistics
+ *
+ * @param deadline absolute time in nanoseconds
+ */
+void sleepUntil(int64_t deadline)
+{
+  struct timespec ts = { .tv_sec = deadline / NSEC_PER_SEC, .tv_nsec = deadline % NSEC_PER_SEC };
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+  int64_t overshoot = monotonicTime() - deadline;
+  if (overshoot < 0) overshoot = 0;
+
+  if (ctx->sharedMemory == NULL) return;
+
+  volatile TimingStats *stats = &ctx->sharedMemory->timing;
+  __atomic_add_fetch(&stats->sleepCount, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&stats->overshootTotal, overshoot, __ATOMIC_RELAXED);
+
+  int64_t max = __atomic_load_n(&stats->overshootMax, __ATOMIC_RELAXED);
+  while (overshoot > max && !__atomic_compare_exchange_n(&stats->overshootMax, &max, overshoot, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Sleep for @p us microseconds scaled by time scale factor
+ *
+ * @param us requested duration in microseconds
+ */
+void sleepFor(int64_t us)
+{
+  int64_t duration = (int64_t)((double)us * NSEC_PER_USEC * ctx->params.timeScale);
+
+  if (ctx->sharedMemory != NULL)
+    __atomic_add_fetch(&ctx->sharedMemory->timing.requestedTotal, duration, __ATOMIC_RELAXED);
+
+  sleepUntil(monotonicTime() + duration);
+}
+
+/**
+ * @brief Generate random duration from interval <@p minUs, @p maxUs>
+ *
+ * @return duration in microseconds
+ */
+int64_t randomDuration(int64_t minUs, int64_t maxUs)
+{
+  return (random() % (maxUs - minUs + 1)) + minUs;
+}
@@ -0,0 +1,25 @@
+/**
+ * @file timing.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for high resolution waiting
+ */
+
+#ifndef IOS_PROJECT2_TIMING_H
+#define IOS_PROJECT2_TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+
+#define NSEC_PER_USEC 1000LL
+#define NSEC_PER_SEC 1000000000LL
+
+int64_t monotonicTime();
+void sleepUntil(int64_t deadline);
+void sleepFor(int64_t us);
+int64_t randomDuration(int64_t minUs, int64_t maxUs);
+
+#endif //IOS_PROJECT2_TIMING_H
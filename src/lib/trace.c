@@ -0,0 +1,139 @@
+/**
+ * @file trace.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Export of entity timelines as Chrome trace events
+ *
+ * Every process appends complete events of its states to one file opened with O_APPEND,
+ * so lines of different processes are never mixed. Workshop is trace process, every
+ * entity is one of its threads identified by process id.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/**
+ * @brief Append one event to trace file
+ */
+static void traceWrite(const char *line, int len)
+{
+  if (len <= 0)
+    return;
+
+  if (len > TRACE_LINE_MAX - 1)
+    len = TRACE_LINE_MAX - 1;
+
+  while (write(ctx->traceFd, line, len) == -1 && errno == EINTR);
+}
+
+/**
+ * @brief Open trace file, must be called before creating any process
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode openTrace()
+{
+  if (ctx->params.tracePath == NULL)
+    return NO_ERROR;
+
+  ctx->traceFd = open(ctx->params.tracePath, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (ctx->traceFd == -1)
+    return OF_OPEN_ERROR;
+
+  ctx->traceEpoch = monotonicTime();
+  traceWrite("[\n", 2);
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Terminate array of trace events and close trace file
+ *
+ * @param retVal pointer to return code that will be returned based on previous state and success of this action
+ */
+void closeTrace(ReturnCode *retVal)
+{
+  if (ctx->traceFd == -1)
+    return;
+
+  char line[TRACE_LINE_MAX];
+  int len = snprintf(line, sizeof(line),
+                     "{\"name\":\"end\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f}\n]\n",
+                     (double)(monotonicTime() - ctx->traceEpoch) / NSEC_PER_USEC);
+  traceWrite(line, len);
+
+  if (close(ctx->traceFd) == -1)
+    (*retVal) |= OF_OPEN_ERROR;
+  ctx->traceFd = -1;
+}
+
+/**
+ * @brief Name trace process of workshop with @p index
+ */
+void traceWorkshop(size_t index)
+{
+  if (ctx->traceFd == -1)
+    return;
+
+  char line[TRACE_LINE_MAX];
+  int len = snprintf(line, sizeof(line),
+                     "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%zu,\"tid\":0,\"args\":{\"name\":\"Workshop %zu\"}},\n",
+                     index, index + 1);
+  traceWrite(line, len);
+}
+
+/**
+ * @brief Name track of entity running in this process
+ *
+ * @param entityName name of entity
+ * @param id id of entity, NO_ID for Santa
+ */
+void traceEntity(const char *entityName, int id)
+{
+  if (ctx->traceFd == -1)
+    return;
+
+  char line[TRACE_LINE_MAX];
+  int len;
+  if (id == NO_ID)
+    len = snprintf(line, sizeof(line),
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%zu,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                   ctx->workshopIndex, (int)getpid(), entityName);
+  else
+    len = snprintf(line, sizeof(line),
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%zu,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}},\n",
+                   ctx->workshopIndex, (int)getpid(), entityName, id);
+  traceWrite(line, len);
+}
+
+/**
+ * @brief Finish current state of entity and start @p state
+ *
+ * Finished state is written as complete event, NULL only finishes current state
+ *
+ * @param state name of new state
+ */
+void traceState(const char *state)
+{
+  if (ctx->traceFd == -1)
+    return;
+
+  int64_t now = monotonicTime();
+
+  if (ctx->traceState != NULL)
+  {
+    char line[TRACE_LINE_MAX];
+    int len = snprintf(line, sizeof(line),
+                       "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%zu,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                       ctx->traceState, ctx->workshopIndex, (int)getpid(),
+                       (double)(ctx->traceStateStart - ctx->traceEpoch) / NSEC_PER_USEC,
+                       (double)(now - ctx->traceStateStart) / NSEC_PER_USEC);
+    traceWrite(line, len);
+  }
+
+  ctx->traceState = state;
+  ctx->traceStateStart = now;
+}
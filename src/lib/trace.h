@@ -0,0 +1,27 @@
+/**
+ * @file trace.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for export of entity timelines as Chrome trace events
+ */
+
+#ifndef IOS_PROJECT2_TRACE_H
+#define IOS_PROJECT2_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "timing.h"
+#include "utils.h"
+
+#define TRACE_LINE_MAX 256
+
+ReturnCode openTrace();
+void closeTrace(ReturnCode *retVal);
+void traceWorkshop(size_t index);
+void traceEntity(const char *entityName, int id);
+void traceState(const char *state);
+
+#endif //IOS_PROJECT2_TRACE_H
@@ -19,9 +19,123 @@ void initSignals()
   signal(SIGUSR2, SIG_IGN);
 }
 
+/**
+ * @brief Long options accepted by program
+ */
+static const struct option longOptions[] = {
+  { "stats", optional_argument, NULL, 's' },
+  { "time-scale", required_argument, NULL, 'S' },
+  { "report", no_argument, NULL, 'R' },
+  { "workshops", required_argument, NULL, 'W' },
+  { "output", required_argument, NULL, 'o' },
+  { "policy", required_argument, NULL, 'P' },
+  { "santa-cpu", required_argument, NULL, 'c' },
+  { "log-cpu", required_argument, NULL, 'l' },
+  { "elf-cpus", required_argument, NULL, 'e' },
+  { "elf-placement", required_argument, NULL, 'E' },
+  { "santa-fifo", optional_argument, NULL, 'F' },
+  { "handoff", required_argument, NULL, 'H' },
+  { "seasons", required_argument, NULL, 'A' },
+  { "duration", required_argument, NULL, 'D' },
+  { "trace", required_argument, NULL, 'T' },
+  { "serve", required_argument, NULL, 'V' },
+  { "connect", required_argument, NULL, 'N' },
+  { "plan", no_argument, NULL, 'L' },
+  { "slo-p99", required_argument, NULL, 'Q' },
+  { 0, 0, 0, 0 }
+};
+
+/**
+ * @brief Parse duration argument
+ *
+ * Accepts milliseconds without suffix or with "ms" suffix and microseconds with "us" suffix
+ *
+ * @param str argument to parse
+ * @param us output duration in microseconds
+ * @return true if duration is valid and not longer than 1000 ms
+ */
+static bool parseDuration(const char *str, int *us)
+{
+  char *rest = NULL;
+  long val = strtol(str, &rest, 10);
+
+  if (rest == str || val < 0) return false;
+
+  if (*rest == 0 || strcmp(rest, "ms") == 0)
+  {
+    if (val > 1000) return false;
+    *us = (int)val * 1000;
+  }
+  else if (strcmp(rest, "us") == 0)
+  {
+    if (val > 1000000) return false;
+    *us = (int)val;
+  }
+  else
+    return false;
+
+  return true;
+}
+
+/**
+ * @brief Check that values of parameters are in allowed ranges
+ *
+ * @param prm parameters to check
+ * @return ReturnCode with NO_ERROR if parameters are valid or INVALID_ARGUMENT_ERROR
+ */
+ReturnCode validateParams(const Params *prm)
+{
+  if (prm->connectAddress != NULL)
+  {
+    // Client can host only elves or only reindeers
+    if (prm->ne < 0 || prm->ne > NET_MAX_ELVES) return INVALID_ARGUMENT_ERROR;
+    if (prm->nr < 0 || prm->nr > NET_MAX_RDS) return INVALID_ARGUMENT_ERROR;
+    if (prm->ne + prm->nr == 0) return INVALID_ARGUMENT_ERROR;
+  }
+  else if (prm->serveAddress != NULL)
+  {
+    if (prm->ne <= 0 || prm->ne > NET_MAX_ELVES) return INVALID_ARGUMENT_ERROR;
+    if (prm->nr <= 0 || prm->nr > NET_MAX_RDS) return INVALID_ARGUMENT_ERROR;
+  }
+  else
+  {
+    if (prm->ne <= 0 || prm->ne >= 1000) return INVALID_ARGUMENT_ERROR;
+    if (prm->nr <= 0 || prm->nr >= 20) return INVALID_ARGUMENT_ERROR;
+  }
+  if (prm->te < 0 || prm->te > 1000000) return INVALID_ARGUMENT_ERROR;
+  if (prm->tr < 0 || prm->tr > 1000000) return INVALID_ARGUMENT_ERROR;
+  if (!(prm->timeScale > 0.0)) return INVALID_ARGUMENT_ERROR;
+  if (prm->workshops <= 0 || prm->workshops > 100000) return INVALID_ARGUMENT_ERROR;
+  if (prm->policy < POLICY_NONE || prm->policy > POLICY_FAIR) return INVALID_ARGUMENT_ERROR;
+  if (prm->handoff < HANDOFF_CLASSIC || prm->handoff > HANDOFF_GROUP) return INVALID_ARGUMENT_ERROR;
+  if (prm->seasons < 0 || prm->duration < 0.0) return INVALID_ARGUMENT_ERROR;
+
+  // Run must have end
+  if (prm->seasons == 0 && prm->duration == 0.0) return INVALID_ARGUMENT_ERROR;
+
+  // Elves can be added on signal only to single workshop
+  if (prm->bflag && prm->workshops > 1) return INVALID_ARGUMENT_ERROR;
+
+  // Plan measures one workshop at a time with fixed number of elves
+  if (prm->plan && (prm->sloP99 == 0.0 || prm->bflag || prm->workshops > 1)) return INVALID_ARGUMENT_ERROR;
+  if (prm->plan && (prm->serveAddress != NULL || prm->connectAddress != NULL)) return INVALID_ARGUMENT_ERROR;
+
+  // Network modes simulate one season of one workshop
+  if (prm->serveAddress != NULL || prm->connectAddress != NULL)
+  {
+    if (prm->serveAddress != NULL && prm->connectAddress != NULL) return INVALID_ARGUMENT_ERROR;
+    if (prm->bflag || prm->workshops > 1 || prm->seasons != 1 || prm->duration > 0.0) return INVALID_ARGUMENT_ERROR;
+  }
+
+  return NO_ERROR;
+}
+
 /**
  * @brief Get values from arguments
  *
+ * Accepts optional flags followed by positional arguments NE NR TE TR,
+ * TE and TR are stored in microseconds
+ *
  * @param argc length of argument array
  * @param argv array of arguments
  * @return ReturnCode with NO_ERROR if it was successful or error code
@@ -29,39 +143,144 @@ void initSignals()
 ReturnCode parseArguments(int argc, char *argv[])
 {
   char *rest = NULL;
-  size_t startIndex = 1;
+  bool sinkGiven = false;
+  int opt;
 
-  if (argc == 5 || argc == 6)
+  ctx->params.timeScale = 1.0;
+  ctx->params.workshops = 1;
+  ctx->params.sinkType = SINK_FILE;
+  ctx->params.sinkTarget = SINK_DEFAULT_PATH;
+  ctx->params.santaCpu = -1;
+  ctx->params.logCpu = -1;
+  ctx->params.seasons = -1;
+
+  opterr = 0;
+  while ((opt = getopt_long(argc, argv, "+b", longOptions, NULL)) != -1)
   {
-    if (argc == 6)
+    switch (opt)
     {
-      startIndex += 1;
-      if (strcmp(argv[1], "-b") != 0) return INVALID_ARGUMENT_ERROR;
-      params.bflag = true;
-    }
+      case 'b':
+        ctx->params.bflag = true;
+        break;
 
-    params.ne = (int)strtol(argv[startIndex], &rest, 10);
-    if (*rest != 0 || params.ne <= 0 || params.ne >= 1000) return INVALID_ARGUMENT_ERROR;
-    
-    params.nr = (int)strtol(argv[startIndex + 1], &rest, 10);
-    if (*rest != 0 || params.nr <= 0 || params.nr >= 20) return INVALID_ARGUMENT_ERROR;
+      case 's':
+        ctx->params.statName = (optarg != NULL) ? optarg : STAT_DEFAULT_NAME;
+        if (ctx->params.statName[0] == 0) return INVALID_ARGUMENT_ERROR;
+        break;
 
-    params.te = (int)strtol(argv[startIndex + 2], &rest, 10);
-    if (*rest != 0 || params.te < 0 || params.te > 1000) return INVALID_ARGUMENT_ERROR;
+      case 'S':
+        ctx->params.timeScale = strtod(optarg, &rest);
+        if (*rest != 0) return INVALID_ARGUMENT_ERROR;
+        break;
 
-    params.tr = (int)strtol(argv[startIndex + 3], &rest, 10);
-    if (*rest != 0 || params.tr < 0 || params.tr > 1000) return INVALID_ARGUMENT_ERROR;
-  }
-  else
-  {
-    return ARGUMENT_COUNT_ERROR;
+      case 'R':
+        ctx->params.report = true;
+        break;
+
+      case 'W':
+        ctx->params.workshops = (int)strtol(optarg, &rest, 10);
+        if (*rest != 0) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'o':
+        if (parseSinkSpec(optarg, &ctx->params) != NO_ERROR) return INVALID_ARGUMENT_ERROR;
+        sinkGiven = true;
+        break;
+
+      case 'P':
+        if (parsePolicy(optarg, &ctx->params.policy) != NO_ERROR) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'c':
+        ctx->params.santaCpu = (int)strtol(optarg, &rest, 10);
+        if (*rest != 0 || ctx->params.santaCpu < 0) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'l':
+        ctx->params.logCpu = (int)strtol(optarg, &rest, 10);
+        if (*rest != 0 || ctx->params.logCpu < 0) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'e':
+        if (parseCpuList(optarg, ctx->params.elfCpus, &ctx->params.elfCpuCount) != NO_ERROR) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'E':
+        if (parseElfPlacement(optarg, &ctx->params.elfPlacement) != NO_ERROR) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'F':
+        ctx->params.santaFifoPriority = (optarg != NULL) ? (int)strtol(optarg, &rest, 10) : 10;
+        if ((optarg != NULL && *rest != 0) || ctx->params.santaFifoPriority < 1 || ctx->params.santaFifoPriority > 99) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'H':
+        if (parseHandoff(optarg, &ctx->params.handoff) != NO_ERROR) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'A':
+        ctx->params.seasons = (int)strtol(optarg, &rest, 10);
+        if (*rest != 0 || ctx->params.seasons <= 0) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'D':
+        ctx->params.duration = strtod(optarg, &rest);
+        if (*rest != 0 || !(ctx->params.duration > 0.0)) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'T':
+        ctx->params.tracePath = optarg;
+        if (ctx->params.tracePath[0] == 0) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'V':
+        ctx->params.serveAddress = optarg;
+        if (!isNetAddress(ctx->params.serveAddress)) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'N':
+        ctx->params.connectAddress = optarg;
+        if (!isNetAddress(ctx->params.connectAddress)) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      case 'L':
+        ctx->params.plan = true;
+        break;
+
+      case 'Q':
+        ctx->params.sloP99 = strtod(optarg, &rest);
+        if (*rest != 0 || !(ctx->params.sloP99 > 0.0)) return INVALID_ARGUMENT_ERROR;
+        break;
+
+      default:
+        return INVALID_ARGUMENT_ERROR;
+    }
   }
 
-  return NO_ERROR;
+  // Runs of plan don't write output unless asked for
+  if (ctx->params.plan && !sinkGiven)
+    ctx->params.sinkType = SINK_NULL;
+
+  // Duration without number of seasons runs until time is up
+  if (ctx->params.seasons < 0)
+    ctx->params.seasons = (ctx->params.duration > 0.0) ? 0 : 1;
+
+  if (argc - optind != 4) return ARGUMENT_COUNT_ERROR;
+
+  ctx->params.ne = (int)strtol(argv[optind], &rest, 10);
+  if (*rest != 0) return INVALID_ARGUMENT_ERROR;
+
+  ctx->params.nr = (int)strtol(argv[optind + 1], &rest, 10);
+  if (*rest != 0) return INVALID_ARGUMENT_ERROR;
+
+  if (!parseDuration(argv[optind + 2], &ctx->params.te)) return INVALID_ARGUMENT_ERROR;
+  if (!parseDuration(argv[optind + 3], &ctx->params.tr)) return INVALID_ARGUMENT_ERROR;
+
+  return validateParams(&ctx->params);
 }
   
 /**
- * @brief Print @p message to output stream
+ * @brief Print @p message to output sink and send it to event pipe when it is open
  * 
  * @param entityName name of entity calling this function
  * @param id id of entity calling this function
@@ -69,17 +288,41 @@ ReturnCode parseArguments(int argc, char *argv[])
  */
 void printToOutput(char *entityName, int id, char *message)
 {
-  sem_wait(&semHolder->writeOutLock);
+  SEM_WAIT(&ctx->semHolder->writeOutLock);
 
-  if (id < 0)
+  if (ctx->params.sinkType != SINK_NULL)
   {
-    fprintf(outputFile, "%d: %s: %s\n", sharedMemory->actionId, entityName, message);
+    char line[128];
+    int len = 0;
+
+    // Lines of workshops sharing one sink are tagged by workshop
+    if (isSinkShared())
+      len = snprintf(line, sizeof(line), "W%zu: ", ctx->workshopIndex + 1);
+
+    if (id < 0)
+    {
+      len += snprintf(line + len, sizeof(line) - len, "%lld: %s: %s\n", (long long)ctx->sharedMemory->actionId, entityName, message);
+    }
+    else
+    {
+      len += snprintf(line + len, sizeof(line) - len, "%lld: %s %d: %s\n", (long long)ctx->sharedMemory->actionId, entityName, id, message);
+    }
+
+    if (len >= (int)sizeof(line))
+      len = sizeof(line) - 1;
+
+    sinkWrite(line, len);
   }
-  else
+
+  // Record is smaller than PIPE_BUF so write is atomic
+  if (ctx->eventPipe != -1)
   {
-    fprintf(outputFile, "%d: %s %d: %s\n", sharedMemory->actionId, entityName, id, message);
+    SantaEvent event = { ctx->sharedMemory->actionId, entityName, id, message };
+    if (write(ctx->eventPipe, &event, sizeof(event)) != sizeof(event))
+      ctx->eventPipe = -1;
   }
 
-  sharedMemory->actionId++;
-  sem_post(&semHolder->writeOutLock);
+  ctx->sharedMemory->actionId++;
+  STAT_ADD(actionId, 1);
+  sem_post(&ctx->semHolder->writeOutLock);
 }
\ No newline at end of file
@@ -10,14 +10,23 @@
 #include <signal.h>
 #include <string.h>
 #include <stdlib.h>
+#include <getopt.h>
 
 #include "static_constructions.h"
 #include "shared_resources.h"
 #include "error_handling.h"
+#include "statistics.h"
+#include "output_sink.h"
+#include "admission.h"
+#include "placement.h"
+#include "handoff.h"
+#include "probes.h"
+#include "network.h"
 
 #define NO_ID -1
 
 void handleUsrSignal();
 void initSignals();
+ReturnCode validateParams(const Params *prm);
 ReturnCode parseArguments(int argc, char *argv[]);
 void printToOutput(char *entityName, int id, char *message);
\ No newline at end of file
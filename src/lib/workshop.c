@@ -0,0 +1,322 @@
+/**
+ * @file workshop.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Creating processes of workshops and waiting for them
+ */
+
+#include "workshop.h"
+
+/**
+ * @brief Release private resources of current workshop
+ *
+ * @param killProcesses kill processes of workshop before reaping them (used on failure)
+ */
+static void releaseWorkshop(bool killProcesses)
+{
+  pid_t *groups[] = { &ctx->processHolder.santaId, ctx->processHolder.elfIds, ctx->processHolder.rdIds };
+  size_t counts[] = { ctx->processHolder.santaId != 0, ctx->processHolder.elvesCount, ctx->processHolder.rdCount };
+
+  for (size_t g = 0; g < 3; g++)
+  {
+    for (size_t i = 0; groups[g] != NULL && i < counts[g]; i++)
+    {
+      if (groups[g][i] <= 0) continue;
+
+      if (killProcesses)
+        kill(groups[g][i], SIGKILL);
+
+      // Reap children so their resource usage is accounted to this process
+      while (waitpid(groups[g][i], NULL, 0) == -1 && errno == EINTR);
+    }
+  }
+
+  closeWorkshopSink();
+
+  if (ctx->eventPipe != -1)
+  {
+    close(ctx->eventPipe);
+    ctx->eventPipe = -1;
+  }
+
+  if (ctx->eventPipeRead != -1)
+  {
+    close(ctx->eventPipeRead);
+    ctx->eventPipeRead = -1;
+  }
+
+  free(ctx->processHolder.elfIds);
+  ctx->processHolder.elfIds = NULL;
+  ctx->processHolder.elvesCount = 0;
+
+  free(ctx->processHolder.rdIds);
+  ctx->processHolder.rdIds = NULL;
+  ctx->processHolder.rdCount = 0;
+
+  ctx->processHolder.santaId = 0;
+}
+
+/**
+ * @brief Kill all created processes of workshop and release its resources
+ *
+ * @param code error that caused abort
+ * @return @p code
+ */
+static ReturnCode abortWorkshop(ReturnCode code)
+{
+  releaseWorkshop(true);
+  return code;
+}
+
+/**
+ * @brief Deliver events from event pipe to @p callback until all processes close it
+ */
+static void deliverEvents(SantaEventCallback callback, void *userData)
+{
+  // Calling process does not write events
+  close(ctx->eventPipe);
+  ctx->eventPipe = -1;
+
+  SantaEvent event;
+  ssize_t len;
+  while ((len = read(ctx->eventPipeRead, &event, sizeof(event))) != 0)
+  {
+    if (len == sizeof(event))
+      callback(&event, userData);
+    else if (len == -1 && errno != EINTR)
+      break;
+  }
+
+  close(ctx->eventPipeRead);
+  ctx->eventPipeRead = -1;
+}
+
+/**
+ * @brief Run one workshop simulation and wait for all its processes
+ *
+ * @param index index of workshop in shared arena
+ * @param callback function receiving all events in calling process, NULL when not used
+ * @param userData pointer passed to @p callback
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode runWorkshop(size_t index, SantaEventCallback callback, void *userData)
+{
+  bindWorkshop(index);
+  ctx->sharedMemory->startTime = monotonicTime();
+
+  // Open output sink
+  ReturnCode retVal = openWorkshopSink(index);
+  if (retVal != NO_ERROR)
+    return retVal;
+
+  traceWorkshop(index);
+
+  // Open event pipe
+  if (callback != NULL)
+  {
+    int fds[2];
+    if (pipe(fds) == -1)
+      return abortWorkshop(PIPE_CREATE_ERROR);
+
+    ctx->eventPipeRead = fds[0];
+    ctx->eventPipe = fds[1];
+  }
+
+  // Create Santa
+  {
+    ctx->processHolder.santaId = fork();
+
+    if (ctx->processHolder.santaId < 0)
+    {
+      ctx->processHolder.santaId = 0;
+      return abortWorkshop(PROCESS_CREATE_ERROR);
+    }
+    else if (ctx->processHolder.santaId == 0)
+    {
+      placeSanta();
+      handle_santa();
+      _exit(0);
+    }
+  }
+
+  // Create elves
+  {
+    SEM_WAIT(&ctx->semHolder->numOfElvesStable);
+    
+    ctx->processHolder.elfIds = (pid_t *)calloc(ctx->params.ne, sizeof(pid_t));
+    if (ctx->processHolder.elfIds == NULL)
+    {
+      sem_post(&ctx->semHolder->numOfElvesStable);
+      return abortWorkshop(PID_ALLOCATION_ERROR);
+    }
+    ctx->processHolder.elvesCount = ctx->params.ne;
+
+    ctx->sharedMemory->numberOfElves = ctx->processHolder.elvesCount;
+    sem_post(&ctx->semHolder->numOfElvesStable);
+
+    for (size_t i = 0; i < ctx->processHolder.elvesCount; i++)
+    {
+      pid_t tmp_proc = fork();
+
+      if (tmp_proc < 0)
+      {
+        return abortWorkshop(PROCESS_CREATE_ERROR);
+      }
+      else if (tmp_proc == 0)
+      {
+        placeElf(i + 1);
+        handle_elf(i + 1);
+        _exit(0);
+      }
+      else
+        ctx->processHolder.elfIds[i] = tmp_proc;
+    }
+  }
+
+  // Create reindeers
+  {
+    ctx->processHolder.rdIds = (pid_t *)calloc(ctx->params.nr, sizeof(pid_t));
+    if (ctx->processHolder.rdIds == NULL)
+    {
+      return abortWorkshop(PID_ALLOCATION_ERROR);
+    }
+    ctx->processHolder.rdCount = ctx->params.nr;
+
+    for (size_t i = 0; i < ctx->processHolder.rdCount; i++)
+    {
+      pid_t tmp_proc = fork();
+
+      if (tmp_proc < 0)
+      {
+        return abortWorkshop(PROCESS_CREATE_ERROR);
+      }
+      else if (tmp_proc == 0)
+      {
+        placeReindeer();
+        handle_rd(i + 1);
+        _exit(0);
+      }
+
+      ctx->processHolder.rdIds[i] = tmp_proc;
+    }
+  }
+
+  placeLogger();
+
+  if (callback != NULL)
+    deliverEvents(callback, userData);
+
+  // If there is pflag
+  if (ctx->params.bflag)
+  {
+    SEM_WAIT(&ctx->semHolder->numOfElvesStable);
+
+    // Add handler for usr signal 1
+    signal(SIGUSR1, addElves);
+
+    // Wait for signals before waiting for elves
+    SEM_WAIT(&ctx->semHolder->christmasStarted);
+
+    // Remove handler for usr signal 1
+    signal(SIGUSR1, SIG_IGN);
+
+    sem_post(&ctx->semHolder->numOfElvesStable);
+  }
+
+  // Wait for all processes to finish
+  size_t finalChildCount = 1 + ctx->processHolder.elvesCount + ctx->processHolder.rdCount;
+  for (size_t i = 0; i < finalChildCount; i++)
+    SEM_WAIT(&ctx->semHolder->childFinished);
+
+  // printf("All childs finished\n");
+
+  releaseWorkshop(false);
+
+  return NO_ERROR;
+}
+
+/**
+ * @brief Send quit signal to all running workshop runners
+ */
+static void stopRunners()
+{
+  for (size_t r = 0; r < ctx->processHolder.runnerCount; r++)
+  {
+    if (ctx->processHolder.runnerIds[r] != 0)
+      kill(ctx->processHolder.runnerIds[r], SIGQUIT);
+  }
+}
+
+/**
+ * @brief Run all workshops from shared arena concurrently
+ *
+ * Workshops are distributed between runner processes, one per online CPU,
+ * each runner simulates its workshops one after another
+ *
+ * @return ReturnCode with NO_ERROR if it was successful or error code
+ */
+ReturnCode runWorkshops()
+{
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t runnerCount = (cpus < 1) ? 1 : (size_t)cpus;
+  if (runnerCount > (size_t)ctx->params.workshops)
+    runnerCount = ctx->params.workshops;
+
+  ctx->processHolder.runnerIds = (pid_t *)calloc(runnerCount, sizeof(pid_t));
+  if (ctx->processHolder.runnerIds == NULL)
+    return PID_ALLOCATION_ERROR;
+  ctx->processHolder.runnerCount = runnerCount;
+
+  ReturnCode retVal = NO_ERROR;
+
+  for (size_t r = 0; r < runnerCount; r++)
+  {
+    pid_t tmp_proc = fork();
+
+    if (tmp_proc < 0)
+    {
+      retVal = PROCESS_CREATE_ERROR;
+      break;
+    }
+    else if (tmp_proc == 0)
+    {
+      // Runner is main process for its workshops
+      ctx->processHolder.mainId = getpid();
+      free(ctx->processHolder.runnerIds);
+      ctx->processHolder.runnerIds = NULL;
+      ctx->processHolder.runnerCount = 0;
+
+      for (size_t w = r; w < (size_t)ctx->params.workshops; w += runnerCount)
+        handleErrors(runWorkshop(w, NULL, NULL));
+
+      _exit(0);
+    }
+    else
+      ctx->processHolder.runnerIds[r] = tmp_proc;
+  }
+
+  // Wait for runners, on failure stop all others
+  if (retVal != NO_ERROR)
+    stopRunners();
+
+  for (size_t r = 0; r < runnerCount; r++)
+  {
+    if (ctx->processHolder.runnerIds[r] == 0) continue;
+
+    int status;
+    while (waitpid(ctx->processHolder.runnerIds[r], &status, 0) == -1 && errno == EINTR);
+    ctx->processHolder.runnerIds[r] = 0;
+
+    if (retVal == NO_ERROR && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+    {
+      retVal = UNEXPECTED_ERROR;
+      stopRunners();
+    }
+  }
+
+  free(ctx->processHolder.runnerIds);
+  ctx->processHolder.runnerIds = NULL;
+  ctx->processHolder.runnerCount = 0;
+
+  return retVal;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file workshop.h
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Definitions for running workshops
+ */
+
+#ifndef IOS_PROJECT2_WORKSHOP_H
+#define IOS_PROJECT2_WORKSHOP_H
+
+#include <stdio.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "static_constructions.h"
+#include "shared_resources.h"
+#include "resource_allocation.h"
+#include "error_handling.h"
+#include "process_handlers.h"
+#include "placement.h"
+#include "probes.h"
+
+ReturnCode runWorkshop(size_t index, SantaEventCallback callback, void *userData);
+ReturnCode runWorkshops();
+
+#endif //IOS_PROJECT2_WORKSHOP_H
@@ -12,7 +12,11 @@
 #include "lib/resource_allocation.h"
 #include "lib/shared_resources.h"
 #include "lib/error_handling.h"
-#include "lib/process_handlers.h"
+#include "lib/workshop.h"
+#include "lib/report.h"
+#include "lib/net_server.h"
+#include "lib/net_client.h"
+#include "lib/planner.h"
 
 /**
  * @brief Entrypoint of program
@@ -25,119 +29,41 @@ int main(int argc, char *argv[])
 {
   // Init signal handlers and get process id of main process
   initSignals();
-  processHolder.mainId = getpid();
+  ctx->processHolder.mainId = getpid();
 
   // Init random generator
-  srand(time(NULL) * processHolder.mainId);
+  srand(time(NULL) * ctx->processHolder.mainId);
 
   // Load arguments
   handleErrors(parseArguments(argc, argv));
 
-  // Open output stream
-  if ((outputFile = fopen("proj2.out", "w")) == NULL)
-    handleErrors(OF_OPEN_ERROR);
-  setbuf(outputFile, NULL);
-
-  // Allocate shared resources
-  handleErrors(allocateResources());
-
-  // Create Santa
+  // Host elves and reindeers of remote Santa
+  if (ctx->params.connectAddress != NULL)
   {
-    processHolder.santaId = fork();
-
-    if (processHolder.santaId < 0)
-    {
-      handleErrors(PROCESS_CREATE_ERROR);
-    }
-    else if (processHolder.santaId == 0)
-    {
-      handle_santa();
-      exit(0);
-    }
-  }
-
-  // Create elves
-  {
-    sem_wait(&semHolder->numOfElvesStable);
-    
-    processHolder.elfIds = (pid_t *)malloc(sizeof(pid_t) * params.ne);
-    if (processHolder.elfIds == NULL)
-    {
-      handleErrors(PROCESS_CREATE_ERROR);
-    }
-    processHolder.elvesCount = params.ne;
-
-    sharedMemory->numberOfElves = processHolder.elvesCount;
-    sem_post(&semHolder->numOfElvesStable);
-
-    for (size_t i = 0; i < processHolder.elvesCount; i++)
-    {
-      pid_t tmp_proc = fork();
-
-      if (tmp_proc < 0)
-      {
-        handleErrors(PROCESS_CREATE_ERROR);
-      }
-      else if (tmp_proc == 0)
-      {
-        handle_elf(i + 1);
-        exit(0);
-      }
-      else
-        processHolder.elfIds[i] = tmp_proc;
-    }
+    handleErrors(runClient());
+    return 0;
   }
 
-  // Create reindeers
+  // Search maximal load, every measured load allocates its own resources
+  if (ctx->params.plan)
   {
-    processHolder.rdIds = (pid_t *)malloc(sizeof(pid_t) * params.nr);
-    if (processHolder.rdIds == NULL)
-    {
-      handleErrors(PROCESS_CREATE_ERROR);
-    }
-    processHolder.rdCount = params.nr;
-
-    for (size_t i = 0; i < processHolder.rdCount; i++)
-    {
-      pid_t tmp_proc = fork();
-
-      if (tmp_proc < 0)
-      {
-        handleErrors(PROCESS_CREATE_ERROR);
-      }
-      else if (tmp_proc == 0)
-      {
-        handle_rd(i + 1);
-        exit(0);
-      }
-
-      processHolder.rdIds[i] = tmp_proc;
-    }
+    handleErrors(runPlan());
+    return 0;
   }
 
-  // If there is pflag
-  if (params.bflag)
-  {
-    sem_wait(&semHolder->numOfElvesStable);
-
-    // Add handler for usr signal 1
-    signal(SIGUSR1, addElves);
-
-    // Wait for signals before waiting for elves
-    sem_wait(&semHolder->christmasStarted);
-
-    // Remove handler for usr signal 1
-    signal(SIGUSR1, SIG_IGN);
-
-    sem_post(&semHolder->numOfElvesStable);
-  }
+  // Allocate shared resources
+  handleErrors(allocateResources());
 
-  // Wait for all processes to finish
-  size_t finalChildCount = 1 + processHolder.elvesCount + processHolder.rdCount;
-  for (size_t i = 0; i < finalChildCount; i++)
-    sem_wait(&semHolder->childFinished);
+  // Run simulation
+  if (ctx->params.serveAddress != NULL)
+    handleErrors(runServer());
+  else if (ctx->params.workshops == 1)
+    handleErrors(runWorkshop(0, NULL, NULL));
+  else
+    handleErrors(runWorkshops());
 
-  // printf("All childs finished\n");
+  if (ctx->params.report)
+    printReport();
 
   // Clear shared resources
   handleErrors(deallocateResources());
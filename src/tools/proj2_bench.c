@@ -0,0 +1,550 @@
+/**
+ * @file proj2_bench.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Benchmark driver running proj2 over matrix of parameters
+ *
+ * Usage: proj2-bench [-p PROJ2] [-e NE,..] [-r NR,..] [-t TE,..] [-T TR,..] [-b 0,1] [-n REPS]
+ *                    [-s SIGNALS] [-d DELAY_MS] [-o RESULTS.csv] [-B BASELINE.csv] [-x THRESHOLD_PCT]
+ *                    [-- EXTRA_PROJ2_ARGS]
+ *
+ * Runs with -b get SIGNALS times SIGUSR1, first one after DELAY_MS and next ones DELAY_MS apart.
+ * Counts are read from proj2.out (proj2.<index>.out with --workshops) in working directory,
+ * so extra arguments can't choose another output sink.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_VALUES 32
+#define MAX_CONFIGS 4096
+#define MAX_EXTRA_ARGS 32
+
+/**
+ * @struct value_list
+ * @brief List of values for one dimension of matrix
+ */
+typedef struct value_list
+{
+  int values[MAX_VALUES];         /**< Values of dimension */
+  size_t count;                   /**< Number of values */
+} ValueList;
+
+/**
+ * @struct bench_config
+ * @brief One point of parameter matrix
+ */
+typedef struct bench_config
+{
+  int ne;                         /**< Number of elves */
+  int nr;                         /**< Number of reindeers */
+  int te;                         /**< Max work time of elf */
+  int tr;                         /**< Max vacation time of reindeer */
+  int bflag;                      /**< Extension flag */
+} BenchConfig;
+
+/**
+ * @struct bench_result
+ * @brief Measured values of one run
+ */
+typedef struct bench_result
+{
+  double wall;                    /**< Wall time in seconds */
+  long events;                    /**< Number of lines in output */
+  long groups;                    /**< Number of helped groups */
+  int signals;                    /**< Number of SIGUSR1 sent to proj2 */
+  long elvesAdded;                /**< Number of elves started beyond NE */
+  long maxRss;                    /**< Peak resident set size in kB */
+  long volCtx;                    /**< Voluntary context switches */
+  long involCtx;                  /**< Involuntary context switches */
+} BenchResult;
+
+/**
+ * @struct bench_summary
+ * @brief Aggregated results of one configuration
+ */
+typedef struct bench_summary
+{
+  BenchConfig config;             /**< Measured configuration */
+  double wall;                    /**< Median wall time */
+  double eventsPerSec;            /**< Median events per second */
+  double groupsPerSec;            /**< Median helped groups per second */
+} BenchSummary;
+
+/**
+ * @brief Parse comma separated list of integers
+ *
+ * @return true if list is valid
+ */
+static bool parseList(const char *str, ValueList *list)
+{
+  char *rest = NULL;
+  list->count = 0;
+
+  while (*str != 0)
+  {
+    if (list->count == MAX_VALUES) return false;
+
+    long val = strtol(str, &rest, 10);
+    if (rest == str || (*rest != ',' && *rest != 0)) return false;
+
+    list->values[list->count++] = (int)val;
+    str = (*rest == ',') ? rest + 1 : rest;
+  }
+
+  return list->count > 0;
+}
+
+/**
+ * @brief Check if @p name is output file of proj2 (proj2.out or proj2.<index>.out)
+ */
+static bool isOutputFile(const char *name)
+{
+  size_t len = strlen(name);
+  return strncmp(name, "proj2.", 6) == 0 && len >= 9 && strcmp(name + len - 4, ".out") == 0;
+
+}
+
+/**
+ * @brief Remove output files of proj2 from @p workDir
+ */
+static void removeOutput(const char *workDir)
+{
+  DIR *dir = opendir(workDir);
+  if (dir == NULL) return;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (!isOutputFile(entry->d_name)) continue;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", workDir, entry->d_name);
+    unlink(path);
+  }
+
+  closedir(dir);
+}
+
+/**
+ * @brief Count lines, helped groups and highest elf id in output file of proj2
+ */
+static void parseOutput(const char *path, BenchResult *result, long *maxElf)
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL) return;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    result->events++;
+    if (strstr(line, "Santa: helping elves") != NULL)
+      result->groups++;
+
+    char *elf = strstr(line, "Elf ");
+    if (elf != NULL && strstr(elf, ": started") != NULL)
+    {
+      long id = strtol(elf + 4, NULL, 10);
+      if (id > *maxElf) *maxElf = id;
+    }
+  }
+
+  fclose(f);
+}
+
+/**
+ * @brief Parse all output files of proj2 in @p workDir
+ */
+static void parseOutputs(const char *workDir, int ne, BenchResult *result)
+{
+  result->events = 0;
+  result->groups = 0;
+  result->elvesAdded = 0;
+
+  DIR *dir = opendir(workDir);
+  if (dir == NULL) return;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (!isOutputFile(entry->d_name)) continue;
+
+    char path[PATH_MAX];
+    long maxElf = 0;
+    snprintf(path, sizeof(path), "%s/%s", workDir, entry->d_name);
+    parseOutput(path, result, &maxElf);
+
+    if (maxElf > ne)
+      result->elvesAdded += maxElf - ne;
+  }
+
+  closedir(dir);
+}
+
+/**
+ * @brief Check that extra arguments of proj2 keep output in proj2.out files
+ */
+static bool checkExtraArgs(char **extra, size_t extraCount)
+{
+  for (size_t i = 0; i < extraCount; i++)
+  {
+    if (strcmp(extra[i], "--output") == 0 || strncmp(extra[i], "--output=", 9) == 0)
+    {
+      fprintf(stderr, "Counts are read from proj2.out, --output can't be passed to proj2\n");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Sleep for @p ms milliseconds
+ */
+static void sleepMs(int ms)
+{
+  struct timespec delay = { ms / 1000, (ms % 1000) * 1000000L };
+  while (nanosleep(&delay, &delay) == -1 && errno == EINTR);
+}
+
+/**
+ * @brief Run proj2 once with @p config in @p workDir
+ *
+ * Runs with bflag get @p signals SIGUSR1, first after @p delay milliseconds and next ones
+ * @p delay milliseconds apart, while proj2 still runs
+ *
+ * @return true if proj2 finished successfully
+ */
+static bool runOnce(const char *proj2, const char *workDir, const BenchConfig *config, char **extra, size_t extraCount,
+                    int signals, int delay, BenchResult *result)
+{
+  char ne[16], nr[16], te[16], tr[16];
+  snprintf(ne, sizeof(ne), "%d", config->ne);
+  snprintf(nr, sizeof(nr), "%d", config->nr);
+  snprintf(te, sizeof(te), "%d", config->te);
+  snprintf(tr, sizeof(tr), "%d", config->tr);
+
+  char *argv[MAX_EXTRA_ARGS + 8];
+  size_t argc = 0;
+  argv[argc++] = (char *)proj2;
+  if (config->bflag) argv[argc++] = "-b";
+  for (size_t i = 0; i < extraCount; i++)
+    argv[argc++] = extra[i];
+  argv[argc++] = ne;
+  argv[argc++] = nr;
+  argv[argc++] = te;
+  argv[argc++] = tr;
+  argv[argc] = NULL;
+
+  // Failed run must not leave output of previous run
+  removeOutput(workDir);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pid_t pid = fork();
+  if (pid < 0) return false;
+  if (pid == 0)
+  {
+    if (chdir(workDir) == -1) _exit(127);
+    execv(proj2, argv);
+    _exit(127);
+  }
+
+  int status;
+  struct rusage ru;
+  pid_t done = 0;
+
+  // Extension adds elves on SIGUSR1, proj2 ignores it before and after it can add them
+  for (int i = 0; config->bflag && i < signals && done == 0; i++)
+  {
+    sleepMs(delay);
+    done = wait4(pid, &status, WNOHANG, &ru);
+    if (done == 0 && kill(pid, SIGUSR1) == 0)
+      result->signals++;
+  }
+
+  while (done <= 0)
+  {
+    done = wait4(pid, &status, 0, &ru);
+    if (done == -1 && errno != EINTR) return false;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  result->wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+  result->maxRss = ru.ru_maxrss;
+  result->volCtx = ru.ru_nvcsw;
+  result->involCtx = ru.ru_nivcsw;
+
+  parseOutputs(workDir, config->ne, result);
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * @brief Compare function for qsort of doubles
+ */
+static int compareDouble(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Compute median of @p count values (array is reordered)
+ */
+static double median(double *values, size_t count)
+{
+  if (count == 0) return 0.0;
+  qsort(values, count, sizeof(double), compareDouble);
+  if (count % 2) return values[count / 2];
+  return (values[count / 2 - 1] + values[count / 2]) / 2.0;
+}
+
+/**
+ * @brief Load and aggregate baseline CSV written by previous run
+ *
+ * @return number of loaded summaries
+ */
+static size_t loadBaseline(const char *path, BenchSummary *summaries, size_t maxCount)
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL) return 0;
+
+  // Rows of one configuration are stored next to each other
+  static double walls[1024], events[1024], groups[1024];
+  size_t count = 0, reps = 0;
+  BenchConfig current = { -1, -1, -1, -1, -1 };
+
+  char line[512];
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    BenchConfig cfg;
+    int rep;
+    double wall, eps, gps;
+    if (sscanf(line, "%d,%d,%d,%d,%d,%d,%lf,%*d,%lf,%*d,%lf", &cfg.ne, &cfg.nr, &cfg.te, &cfg.tr, &cfg.bflag, &rep, &wall, &eps, &gps) != 9)
+      continue;
+
+    if (memcmp(&cfg, &current, sizeof(cfg)) != 0)
+    {
+      if (reps > 0 && count < maxCount)
+      {
+        summaries[count].config = current;
+        summaries[count].wall = median(walls, reps);
+        summaries[count].eventsPerSec = median(events, reps);
+        summaries[count].groupsPerSec = median(groups, reps);
+        count++;
+      }
+      current = cfg;
+      reps = 0;
+    }
+
+    if (reps < 1024)
+    {
+      walls[reps] = wall;
+      events[reps] = eps;
+      groups[reps] = gps;
+      reps++;
+    }
+  }
+
+  if (reps > 0 && count < maxCount)
+  {
+    summaries[count].config = current;
+    summaries[count].wall = median(walls, reps);
+    summaries[count].eventsPerSec = median(events, reps);
+    summaries[count].groupsPerSec = median(groups, reps);
+    count++;
+  }
+
+  fclose(f);
+  return count;
+}
+
+/**
+ * @brief Print usage of benchmark driver
+ */
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-p PROJ2] [-e NE,..] [-r NR,..] [-t TE,..] [-T TR,..] [-b 0,1] [-n REPS]\n"
+                  "          [-s SIGNALS] [-d DELAY_MS] [-o RESULTS.csv] [-B BASELINE.csv] [-x THRESHOLD_PCT]\n"
+                  "          [-- EXTRA_PROJ2_ARGS]\n", name);
+}
+
+/**
+ * @brief Entrypoint of benchmark driver
+ *
+ * @param argc number of arguments
+ * @param argv array of arguments
+ * @return 0 on success, 1 on error, 2 when regression was detected
+ */
+int main(int argc, char *argv[])
+{
+  const char *proj2Arg = "./proj2";
+  const char *outPath = "bench_results.csv";
+  const char *baselinePath = NULL;
+  double threshold = 10.0;
+  int reps = 3;
+  int signals = 1;
+  int delay = 20;
+
+
+  ValueList ne = { { 10, 100 }, 2 };
+  ValueList nr = { { 5 }, 1 };
+  ValueList te = { { 0, 10 }, 2 };
+  ValueList tr = { { 50 }, 1 };
+  ValueList bf = { { 0 }, 1 };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:e:r:t:T:b:n:s:d:o:B:x:")) != -1)
+  {
+    bool ok = true;
+    switch (opt)
+    {
+      case 'p': proj2Arg = optarg; break;
+      case 'e': ok = parseList(optarg, &ne); break;
+      case 'r': ok = parseList(optarg, &nr); break;
+      case 't': ok = parseList(optarg, &te); break;
+      case 'T': ok = parseList(optarg, &tr); break;
+      case 'b': ok = parseList(optarg, &bf); break;
+      case 'n': reps = atoi(optarg); ok = reps > 0; break;
+      case 's': signals = atoi(optarg); ok = signals >= 0; break;
+      case 'd': delay = atoi(optarg); ok = delay >= 0; break;
+      case 'o': outPath = optarg; break;
+      case 'B': baselinePath = optarg; break;
+      case 'x': threshold = atof(optarg); ok = threshold >= 0.0; break;
+      default: ok = false; break;
+    }
+
+    if (!ok)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  char **extra = argv + optind;
+  size_t extraCount = (size_t)(argc - optind);
+  if (extraCount > MAX_EXTRA_ARGS)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (!checkExtraArgs(extra, extraCount))
+    return 1;
+
+  char proj2[PATH_MAX];
+  if (realpath(proj2Arg, proj2) == NULL)
+  {
+    fprintf(stderr, "Failed to find %s\n", proj2Arg);
+    return 1;
+  }
+
+  char workDir[] = "/tmp/proj2-bench.XXXXXX";
+  if (mkdtemp(workDir) == NULL)
+  {
+    fprintf(stderr, "Failed to create working directory\n");
+    return 1;
+  }
+
+  static BenchSummary baseline[MAX_CONFIGS];
+  size_t baselineCount = (baselinePath != NULL) ? loadBaseline(baselinePath, baseline, MAX_CONFIGS) : 0;
+
+  FILE *out = fopen(outPath, "w");
+  if (out == NULL)
+  {
+    fprintf(stderr, "Failed to open %s\n", outPath);
+    rmdir(workDir);
+    return 1;
+  }
+  fprintf(out, "ne,nr,te,tr,b,rep,wall_s,events,events_per_sec,groups,groups_per_sec,max_rss_kb,vol_ctx,invol_ctx,signals,elves_added\n");
+
+  double *walls = malloc(sizeof(double) * reps);
+  double *events = malloc(sizeof(double) * reps);
+  double *groups = malloc(sizeof(double) * reps);
+  if (walls == NULL || events == NULL || groups == NULL)
+  {
+    fprintf(stderr, "Failed to allocate memory\n");
+    return 1;
+  }
+
+  int regressions = 0, failures = 0;
+
+  printf("%-22s %10s %12s %12s %s\n", "config", "wall_s", "events/s", "groups/s", "vs baseline");
+
+  for (size_t a = 0; a < ne.count; a++)
+  for (size_t b = 0; b < nr.count; b++)
+  for (size_t c = 0; c < te.count; c++)
+  for (size_t d = 0; d < tr.count; d++)
+  for (size_t e = 0; e < bf.count; e++)
+  {
+    BenchConfig cfg = { ne.values[a], nr.values[b], te.values[c], tr.values[d], bf.values[e] != 0 };
+
+    for (int r = 0; r < reps; r++)
+    {
+      BenchResult res = { 0 };
+      if (!runOnce(proj2, workDir, &cfg, extra, extraCount, signals, delay, &res))
+      {
+        fprintf(stderr, "Run %d %d %d %d b=%d failed\n", cfg.ne, cfg.nr, cfg.te, cfg.tr, cfg.bflag);
+        failures++;
+      }
+
+      walls[r] = res.wall;
+      events[r] = res.wall > 0 ? res.events / res.wall : 0.0;
+      groups[r] = res.wall > 0 ? res.groups / res.wall : 0.0;
+
+      fprintf(out, "%d,%d,%d,%d,%d,%d,%.6f,%ld,%.1f,%ld,%.1f,%ld,%ld,%ld,%d,%ld\n",
+              cfg.ne, cfg.nr, cfg.te, cfg.tr, cfg.bflag, r, res.wall, res.events, events[r],
+              res.groups, groups[r], res.maxRss, res.volCtx, res.involCtx, res.signals, res.elvesAdded);
+      fflush(out);
+    }
+
+    BenchSummary sum = { cfg, median(walls, reps), median(events, reps), median(groups, reps) };
+
+    char name[64], verdict[128] = "-";
+    snprintf(name, sizeof(name), "%d %d %d %d%s", cfg.ne, cfg.nr, cfg.te, cfg.tr, cfg.bflag ? " -b" : "");
+
+    for (size_t i = 0; i < baselineCount; i++)
+    {
+      if (memcmp(&baseline[i].config, &cfg, sizeof(cfg)) != 0) continue;
+
+      double eventsDiff = baseline[i].eventsPerSec > 0 ? (sum.eventsPerSec / baseline[i].eventsPerSec - 1.0) * 100.0 : 0.0;
+      double wallDiff = baseline[i].wall > 0 ? (sum.wall / baseline[i].wall - 1.0) * 100.0 : 0.0;
+      bool regressed = eventsDiff < -threshold || wallDiff > threshold;
+      regressions += regressed;
+
+      snprintf(verdict, sizeof(verdict), "events %+.1f%% wall %+.1f%%%s", eventsDiff, wallDiff, regressed ? "  REGRESSION" : "");
+      break;
+    }
+
+    printf("%-22s %10.3f %12.1f %12.1f %s\n", name, sum.wall, sum.eventsPerSec, sum.groupsPerSec, verdict);
+  }
+
+  fclose(out);
+  free(walls);
+  free(events);
+  free(groups);
+
+  removeOutput(workDir);
+  rmdir(workDir);
+
+  if (failures) fprintf(stderr, "%d runs failed\n", failures);
+  if (regressions) fprintf(stderr, "%d configurations regressed beyond %.1f%%\n", regressions, threshold);
+
+  if (failures) return 1;
+  return regressions ? 2 : 0;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file proj2_stat.c
+ * @author Martin Douša
+ * @date April 2021
+ * @brief Tool attaching to statistics segment published by proj2
+ *
+ * Usage: proj2-stat [-c] [-w] [-i INTERVAL_MS] [NAME]
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lib/statistics.h"
+
+/**
+ * @struct stat_sample
+ * @brief Snapshot of statistics segment counters
+ */
+typedef struct stat_sample
+{
+  int64_t time;                   /**< Time of sample in nanoseconds */
+  int64_t elves[ELF_STATE_COUNT]; /**< Number of elves in each state */
+  int64_t groupsServed;           /**< Number of served groups */
+  int64_t rdReturned;             /**< Number of reindeers returned in current season */
+  int64_t seasons;                /**< Number of finished seasons */
+  int64_t actionId;               /**< Last used action id */
+  int32_t finished;               /**< Simulation finished flag */
+} StatSample;
+
+/**
+ * @brief Attach to statistics segment read-only
+ *
+ * @param name name of segment
+ * @return pointer to mapped segment or NULL on fail
+ */
+static const StatSegment *attachSegment(const char *name)
+{
+  char path[256];
+  if (name[0] == '/')
+    snprintf(path, sizeof(path), "%s", name);
+  else
+    snprintf(path, sizeof(path), "/%s", name);
+
+  int fd = shm_open(path, O_RDONLY, 0);
+  if (fd == -1) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(StatSegment))
+  {
+    close(fd);
+    return NULL;
+  }
+
+  void *mem = mmap(NULL, sizeof(StatSegment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) return NULL;
+
+  const StatSegment *seg = mem;
+  if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != STAT_SEGMENT_MAGIC || seg->version != STAT_SEGMENT_VERSION)
+  {
+    munmap(mem, sizeof(StatSegment));
+    return NULL;
+  }
+
+  return seg;
+}
+
+/**
+ * @brief Take snapshot of counters in segment
+ *
+ * @param seg attached segment
+ * @param sample output sample
+ */
+static void takeSample(const StatSegment *seg, StatSample *sample)
+{
+  sample->time = monotonicTime();
+  for (int i = 0; i < ELF_STATE_COUNT; i++)
+    sample->elves[i] = __atomic_load_n(&seg->elves[i], __ATOMIC_RELAXED);
+  sample->groupsServed = __atomic_load_n(&seg->groupsServed, __ATOMIC_RELAXED);
+  sample->rdReturned = __atomic_load_n(&seg->rdReturned, __ATOMIC_RELAXED);
+  sample->seasons = __atomic_load_n(&seg->seasons, __ATOMIC_RELAXED);
+  sample->actionId = __atomic_load_n(&seg->actionId, __ATOMIC_RELAXED);
+  sample->finished = __atomic_load_n(&seg->finished, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Compute rate of counter between two samples
+ */
+static double rate(int64_t now, int64_t before, int64_t nowTime, int64_t beforeTime)
+{
+  if (nowTime <= beforeTime) return 0.0;
+  return (double)(now - before) * 1e9 / (double)(nowTime - beforeTime);
+}
+
+/**
+ * @brief Print refreshing view of statistics
+ */
+static void printView(const char *name, const StatSegment *seg, const StatSample *cur, const StatSample *prev)
+{
+  double uptime = (double)(cur->time - seg->startTime) / 1e9;
+
+  printf("\033[H\033[2J");
+  printf("proj2 statistics %s (pid %d)  uptime %.1f s%s\n\n", name, (int)seg->ownerId, uptime, cur->finished ? "  [finished]" : "");
+  printf("  elves working       %8lld\n", (long long)cur->elves[ELF_WORKING]);
+  printf("  elves queued        %8lld\n", (long long)cur->elves[ELF_QUEUED]);
+  printf("  elves being helped  %8lld\n", (long long)cur->elves[ELF_HELPED]);
+  printf("  elves on holidays   %8lld\n", (long long)cur->elves[ELF_HOLIDAYS]);
+  printf("  groups served       %8lld\n", (long long)cur->groupsServed);
+  printf("  seasons finished    %8lld\n", (long long)cur->seasons);
+  printf("  reindeers back      %8lld / %d\n", (long long)cur->rdReturned, seg->nr * seg->workshops);
+  printf("  action id           %8lld\n\n", (long long)cur->actionId);
+  printf("  events/sec          %10.1f  (avg %.1f)\n",
+         rate(cur->actionId, prev->actionId, cur->time, prev->time),
+         rate(cur->actionId, 0, cur->time, seg->startTime));
+  printf("  groups/sec          %10.1f  (avg %.1f)\n",
+         rate(cur->groupsServed, prev->groupsServed, cur->time, prev->time),
+         rate(cur->groupsServed, 0, cur->time, seg->startTime));
+  fflush(stdout);
+}
+
+/**
+ * @brief Print one CSV line of statistics
+ */
+static void printCsv(const StatSegment *seg, const StatSample *cur, const StatSample *prev)
+{
+  printf("%.3f,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%.1f,%.1f\n",
+         (double)(cur->time - seg->startTime) / 1e9,
+         (long long)cur->elves[ELF_WORKING], (long long)cur->elves[ELF_QUEUED],
+         (long long)cur->elves[ELF_HELPED], (long long)cur->elves[ELF_HOLIDAYS],
+         (long long)cur->groupsServed, (long long)cur->rdReturned, (long long)cur->seasons,
+         (long long)cur->actionId,
+         rate(cur->actionId, prev->actionId, cur->time, prev->time),
+         rate(cur->groupsServed, prev->groupsServed, cur->time, prev->time));
+  fflush(stdout);
+}
+
+/**
+ * @brief Entrypoint of statistics tool
+ *
+ * @param argc number of arguments
+ * @param argv array of arguments
+ * @return 0 on success, 1 when segment can't be attached
+ */
+int main(int argc, char *argv[])
+{
+  bool csv = false;
+  bool waitForSegment = false;
+  long interval = 500;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "cwi:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        csv = true;
+        break;
+
+      case 'w':
+        waitForSegment = true;
+        break;
+
+      case 'i':
+        interval = strtol(optarg, NULL, 10);
+        if (interval <= 0)
+        {
+          fprintf(stderr, "Invalid interval\n");
+          return 1;
+        }
+        break;
+
+      default:
+        fprintf(stderr, "Usage: %s [-c] [-w] [-i INTERVAL_MS] [NAME]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  const char *name = (optind < argc) ? argv[optind] : STAT_DEFAULT_NAME;
+
+  const StatSegment *seg;
+  while ((seg = attachSegment(name)) == NULL)
+  {
+    if (!waitForSegment)
+    {
+      fprintf(stderr, "Failed to attach statistics segment %s\n", name);
+      return 1;
+    }
+    usleep(interval * 1000);
+  }
+
+  StatSample prev, cur;
+  takeSample(seg, &prev);
+  prev.time = seg->startTime;
+  memset(prev.elves, 0, sizeof(prev.elves));
+  prev.groupsServed = prev.rdReturned = prev.seasons = prev.actionId = 0;
+
+  if (csv)
+    printf("time_s,elves_working,elves_queued,elves_helped,elves_holidays,groups_served,rd_returned,seasons,action_id,events_per_sec,groups_per_sec\n");
+
+  while (true)
+  {
+    takeSample(seg, &cur);
+
+    if (csv)
+      printCsv(seg, &cur, &prev);
+    else
+      printView(name, seg, &cur, &prev);
+
+    if (cur.finished) break;
+
+    prev = cur;
+    usleep(interval * 1000);
+  }
+
+  munmap((void *)seg, sizeof(StatSegment));
+  return 0;
+}